@@ -0,0 +1,217 @@
+#ifndef ARP_TUNING_H
+#define ARP_TUNING_H
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+
+namespace ns3 {
+
+/*
+ * Parametros dos ArpCache criados daqui para frente (chamar antes de
+ * instalar a pilha). O ArpCache do ns-3 nao tem limite de entradas, entao
+ * o que da para ajustar e o tempo de vida das entradas, a espera pela
+ * resposta, as retransmissoes e a fila de pacotes pendentes por entrada.
+ */
+inline void
+ConfigureArp (Time aliveTimeout, Time deadTimeout, Time waitReplyTimeout, uint32_t maxRetries,
+              uint32_t pendingQueueSize)
+{
+  Config::SetDefault ("ns3::ArpCache::AliveTimeout", TimeValue (aliveTimeout));
+  Config::SetDefault ("ns3::ArpCache::DeadTimeout", TimeValue (deadTimeout));
+  Config::SetDefault ("ns3::ArpCache::WaitReplyTimeout", TimeValue (waitReplyTimeout));
+  Config::SetDefault ("ns3::ArpCache::MaxRetries", UintegerValue (maxRetries));
+  Config::SetDefault ("ns3::ArpCache::PendingQueueSize", UintegerValue (pendingQueueSize));
+}
+
+/*
+ * Preenche os caches ARP de todos os nos com entradas permanentes para os
+ * vizinhos de cada canal, tiradas da propria topologia. Assim o primeiro
+ * pacote por um proximo salto novo (depois de uma queda) sai sem esperar
+ * resolucao. Entradas que ja existem (por exemplo de um checkpoint) ficam
+ * como estao. So os devices que precisam de ARP (CSMA) tem cache.
+ */
+inline uint32_t
+PopulateArpCaches (NodeContainer nodes)
+{
+  uint32_t added = 0;
+  for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+    {
+      Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+      for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+        {
+          Ptr<ArpCache> cache = ipv4->GetInterface (i)->GetArpCache ();
+          Ptr<Channel> channel = ipv4->GetNetDevice (i)->GetChannel ();
+          for (uint32_t d = 0; cache && channel && d < channel->GetNDevices (); d++)
+            {
+              Ptr<NetDevice> peer = channel->GetDevice (d);
+              Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+              if (peer == ipv4->GetNetDevice (i) || !peerIpv4)
+                {
+                  continue;
+                }
+              int32_t peerIf = peerIpv4->GetInterfaceForDevice (peer);
+              for (uint32_t j = 0; peerIf >= 0 && j < peerIpv4->GetNAddresses (peerIf); j++)
+                {
+                  Ipv4Address peerAddr = peerIpv4->GetAddress (peerIf, j).GetLocal ();
+                  if (cache->Lookup (peerAddr))
+                    {
+                      continue;
+                    }
+                  ArpCache::Entry *entry = cache->Add (peerAddr);
+                  entry->SetMacAddress (peer->GetAddress ());
+                  entry->MarkPermanent ();
+                  added++;
+                }
+            }
+        }
+    }
+  return added;
+}
+
+/*
+ * Contadores ARP por no: requests e replies enviados (PhyTxBegin dos devices
+ * CSMA, o unico meio do cenario com ARP) e recebidos (handler do protocolo
+ * ARP no no), descartes do ArpCache (fila pendente cheia ou resolucao que
+ * esgotou as tentativas) e o tempo de resolucao, do primeiro request para
+ * um endereco ate a reply dele. E esse tempo que separa a espera por ARP
+ * da convergencia do roteamento.
+ */
+class ArpStats
+{
+public:
+  void Install (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        if (!ipv4)
+          {
+            continue;
+          }
+        Ptr<Counters> c = Create<Counters> ();
+        c->node = *n;
+        m_counters.push_back (c);
+        (*n)->RegisterProtocolHandler (MakeCallback (&Counters::Rx, c), ArpL3Protocol::PROT_NUMBER, 0);
+        for (uint32_t i = 1; i < ipv4->GetNInterfaces (); i++)
+          {
+            if (DynamicCast<CsmaNetDevice> (ipv4->GetNetDevice (i)))
+              {
+                ipv4->GetNetDevice (i)->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&Counters::Tx, c));
+              }
+            Ptr<ArpCache> cache = ipv4->GetInterface (i)->GetArpCache ();
+            if (cache)
+              {
+                cache->TraceConnectWithoutContext ("Drop", MakeCallback (&Counters::Drop, c));
+              }
+          }
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "ARP per node" << std::endl;
+    for (std::vector<Ptr<Counters> >::const_iterator it = m_counters.begin (); it != m_counters.end (); ++it)
+      {
+        Ptr<Counters> c = *it;
+        os << "  " << Names::FindName (c->node) << " requestsTx=" << c->requestsTx << " repliesTx=" << c->repliesTx
+           << " requestsRx=" << c->requestsRx << " repliesRx=" << c->repliesRx << " drops=" << c->drops
+           << " resolutions=" << c->resolutions;
+        if (c->resolutions)
+          {
+            os << " meanWait=" << c->totalWait.GetSeconds () * 1000 / c->resolutions << "ms"
+               << " maxWait=" << c->maxWait.GetMilliSeconds () << "ms";
+          }
+        os << std::endl;
+      }
+  }
+
+private:
+  struct Counters : public SimpleRefCount<Counters>
+  {
+    Counters ()
+      : requestsTx (0), repliesTx (0), requestsRx (0), repliesRx (0), drops (0), resolutions (0)
+    {
+    }
+
+    void Tx (Ptr<const Packet> packet)
+    {
+      // EtherType (2 bytes no offset 12) lido sem copiar; so quadros ARP sao copiados
+      uint8_t head[14];
+      if (packet->GetSize () < sizeof (head))
+        {
+          return;
+        }
+      packet->CopyData (head, sizeof (head));
+      if (((head[12] << 8) | head[13]) != ArpL3Protocol::PROT_NUMBER)
+        {
+          return;
+        }
+      Ptr<Packet> copy = packet->Copy ();
+      EthernetHeader eth (false);
+      copy->RemoveHeader (eth);
+      ArpHeader arp;
+      copy->RemoveHeader (arp);
+      if (arp.IsRequest ())
+        {
+          requestsTx++;
+          // Retransmissoes nao reiniciam a espera
+          pending.insert (std::make_pair (arp.GetDestinationIpv4Address ().Get (), Simulator::Now ()));
+        }
+      else
+        {
+          repliesTx++;
+        }
+    }
+
+    void Rx (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from,
+             const Address &to, NetDevice::PacketType packetType)
+    {
+      ArpHeader arp;
+      packet->PeekHeader (arp);
+      if (arp.IsRequest ())
+        {
+          requestsRx++;
+          return;
+        }
+      repliesRx++;
+      std::map<uint32_t, Time>::iterator it = pending.find (arp.GetSourceIpv4Address ().Get ());
+      if (it != pending.end ())
+        {
+          Time wait = Simulator::Now () - it->second;
+          resolutions++;
+          totalWait += wait;
+          maxWait = std::max (maxWait, wait);
+          pending.erase (it);
+        }
+    }
+
+    void Drop (Ptr<const Packet> packet)
+    {
+      drops++;
+    }
+
+    Ptr<Node> node;
+    uint64_t requestsTx;
+    uint64_t repliesTx;
+    uint64_t requestsRx;
+    uint64_t repliesRx;
+    uint64_t drops;
+    uint64_t resolutions;
+    Time totalWait;
+    Time maxWait;
+    std::map<uint32_t, Time> pending;
+  };
+
+  std::vector<Ptr<Counters> > m_counters;
+};
+
+} // namespace ns3
+
+#endif /* ARP_TUNING_H */
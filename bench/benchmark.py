@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+Benchmark dos quatro cenarios (topologia-i-rip, topologia-ii-rip,
+topologia-1-ls, topologia-2-ls).
+
+Cada cenario roda no tamanho original e com --scale=100/1000/10000
+roteadores extras, com tracing+animacao ligados e desligados. Nos cenarios
+RIP a grade passa do diametro de 15 saltos ja com 100 roteadores e nao
+converge inteira (ver scale-topology.h): os casos medem custo, nao
+convergencia. Para cada
+execucao sao gravados tempo de parede, eventos/s (--perfStats), pico de RSS
+e bytes de saida em um arquivo JSON lines.
+
+Rodar de dentro do ambiente do ns-3 (./waf shell), apontando para o
+diretorio onde os binarios de scratch foram gerados:
+
+  ./waf shell
+  python3 bench/benchmark.py --bin-dir build/scratch --output results.json
+  python3 bench/benchmark.py --bin-dir build/scratch --baseline baseline.json
+
+Com --baseline, cada caso cujo tempo de parede ou RSS piorar mais que
+--threshold (fracao) em relacao ao baseline e marcado como regressao e o
+script termina com codigo 1. --save-baseline grava os resultados atuais
+como novo baseline.
+
+Com --slim os roteadores da grade usam a pilha reduzida (--slimRouters) e
+os casos ganham o sufixo /slim, para comparar com os da pilha completa.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+SCENARIOS = ["topologia-i-rip", "topologia-ii-rip", "topologia-1-ls", "topologia-2-ls"]
+SCALES = [0, 100, 1000, 10000]
+
+
+def output_bytes(path):
+    total = 0
+    for root, _, files in os.walk(path):
+        for name in files:
+            total += os.path.getsize(os.path.join(root, name))
+    return total
+
+
+def run_case(binary, scale, traces, slim=False):
+    """Roda um caso num diretorio temporario; o pico de RSS vem do wait4."""
+    workdir = tempfile.mkdtemp(prefix="bench-")
+    flag = "true" if traces else "false"
+    args = [binary, "--scale=%d" % scale, "--tracing=" + flag,
+            "--animation=" + flag, "--perfStats=true"]
+    if slim:
+        args.append("--slimRouters=true")
+    out = open(os.path.join(workdir, ".stdout"), "w+")
+    start = time.time()
+    proc = subprocess.Popen(args, cwd=workdir, stdout=out, stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    proc.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+    out.seek(0)
+    events = 0
+    for line in out:
+        if line.startswith("Events "):
+            events = int(line.split()[1])
+    out.close()
+    os.remove(os.path.join(workdir, ".stdout"))
+    result = {
+        "wall_s": wall,
+        "events": events,
+        "events_per_s": events / wall if wall > 0 else 0.0,
+        # ru_maxrss e em KiB no Linux
+        "peak_rss_kb": usage.ru_maxrss,
+        "output_bytes": output_bytes(workdir),
+        "returncode": proc.returncode,
+    }
+    shutil.rmtree(workdir, ignore_errors=True)
+    return result
+
+
+def case_key(case):
+    key = "%s/scale=%d/traces=%s" % (case["scenario"], case["scale"], case["traces"])
+    if case.get("slim"):
+        key += "/slim"
+    return key
+
+
+def compare(results, baseline_file, threshold):
+    with open(baseline_file) as f:
+        baseline = dict((case_key(c), c) for c in map(json.loads, f))
+    regressions = []
+    for case in results:
+        base = baseline.get(case_key(case))
+        if base is None:
+            continue
+        if case["returncode"] != 0 and base.get("returncode", 0) == 0:
+            regressions.append("%s returncode 0 -> %d" % (case_key(case), case["returncode"]))
+            continue
+        for metric in ("wall_s", "peak_rss_kb"):
+            if base[metric] > 0 and case[metric] > base[metric] * (1 + threshold):
+                regressions.append("%s %s %.3f -> %.3f" % (case_key(case), metric,
+                                                           base[metric], case[metric]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--bin-dir", default="build/scratch",
+                        help="directory with the compiled scenario binaries")
+    parser.add_argument("--scenarios", nargs="*", default=SCENARIOS)
+    parser.add_argument("--scales", nargs="*", type=int, default=SCALES)
+    parser.add_argument("--output", default="bench-results.json",
+                        help="JSON lines file the results are appended to")
+    parser.add_argument("--baseline", help="JSON lines baseline to compare against")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed relative slowdown before flagging (default 0.10)")
+    parser.add_argument("--save-baseline", help="also write the results to this baseline file")
+    parser.add_argument("--slim", action="store_true",
+                        help="run the grid routers with the slim stack (--slimRouters)")
+    args = parser.parse_args()
+
+    results = []
+    for scenario in args.scenarios:
+        binary = os.path.abspath(os.path.join(args.bin_dir, scenario))
+        for scale in args.scales:
+            for traces in (True, False):
+                case = {"scenario": scenario, "scale": scale, "traces": traces,
+                        "slim": args.slim, "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S")}
+                case.update(run_case(binary, scale, traces, args.slim))
+                results.append(case)
+                print("%-45s wall=%8.2fs events/s=%10.0f rss=%8dkB out=%10dB%s" % (
+                    case_key(case), case["wall_s"], case["events_per_s"],
+                    case["peak_rss_kb"], case["output_bytes"],
+                    "" if case["returncode"] == 0 else " FAILED(%d)" % case["returncode"]))
+                sys.stdout.flush()
+
+    with open(args.output, "a") as f:
+        for case in results:
+            f.write(json.dumps(case) + "\n")
+    if args.save_baseline:
+        with open(args.save_baseline, "w") as f:
+            for case in results:
+                f.write(json.dumps(case) + "\n")
+
+    if args.baseline:
+        regressions = compare(results, args.baseline, args.threshold)
+        for r in regressions:
+            print("REGRESSION " + r)
+        if regressions:
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,463 @@
+#ifndef BFD_H
+#define BFD_H
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/*
+ * Pacote de controle BFD (RFC 5880, secao 4.1), sem autenticacao: 24 bytes.
+ */
+class BfdHeader : public Header
+{
+public:
+  enum State
+  {
+    ADMIN_DOWN = 0,
+    DOWN = 1,
+    INIT = 2,
+    UP = 3
+  };
+
+  enum Diagnostic
+  {
+    NO_DIAGNOSTIC = 0,
+    DETECTION_TIME_EXPIRED = 1,
+    NEIGHBOR_SIGNALED_DOWN = 3
+  };
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::BfdHeader")
+      .SetParent<Header> ()
+      .SetGroupName ("Internet")
+      .AddConstructor<BfdHeader> ();
+    return tid;
+  }
+
+  BfdHeader ()
+    : diagnostic (NO_DIAGNOSTIC), state (DOWN), multiplier (0), myDiscriminator (0), yourDiscriminator (0),
+      desiredMinTx (0), requiredMinRx (0)
+  {
+  }
+
+  TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+
+  uint32_t GetSerializedSize (void) const
+  {
+    return 24;
+  }
+
+  void Serialize (Buffer::Iterator start) const
+  {
+    start.WriteU8 ((1 << 5) | (diagnostic & 0x1f));
+    start.WriteU8 (state << 6);
+    start.WriteU8 (multiplier);
+    start.WriteU8 (GetSerializedSize ());
+    start.WriteHtonU32 (myDiscriminator);
+    start.WriteHtonU32 (yourDiscriminator);
+    start.WriteHtonU32 (desiredMinTx);
+    start.WriteHtonU32 (requiredMinRx);
+    start.WriteHtonU32 (0); // Required Min Echo RX Interval: sem modo echo
+  }
+
+  uint32_t Deserialize (Buffer::Iterator start)
+  {
+    diagnostic = start.ReadU8 () & 0x1f;
+    state = start.ReadU8 () >> 6;
+    multiplier = start.ReadU8 ();
+    start.ReadU8 ();
+    myDiscriminator = start.ReadNtohU32 ();
+    yourDiscriminator = start.ReadNtohU32 ();
+    desiredMinTx = start.ReadNtohU32 ();
+    requiredMinRx = start.ReadNtohU32 ();
+    start.ReadNtohU32 ();
+    return GetSerializedSize ();
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "state=" << uint32_t (state) << " diag=" << uint32_t (diagnostic) << " mult=" << uint32_t (multiplier)
+       << " my=" << myDiscriminator << " your=" << yourDiscriminator
+       << " minTx=" << desiredMinTx << "us minRx=" << requiredMinRx << "us";
+  }
+
+  uint8_t diagnostic;
+  uint8_t state;
+  uint8_t multiplier;
+  uint32_t myDiscriminator;
+  uint32_t yourDiscriminator;
+  uint32_t desiredMinTx;   // microssegundos
+  uint32_t requiredMinRx;  // microssegundos
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BfdHeader);
+
+/*
+ * Deteccao de falha no estilo BFD de salto unico (RFC 5880/5881) entre
+ * roteadores vizinhos.
+ *
+ * Cada par de roteadores que divide um enlace tem uma sessao: pacotes de
+ * controle UDP 3784 a cada intervalo (com o jitter de 0-25% da RFC) levando
+ * o estado da sessao, e a queda e declarada quando passam multiplicador x
+ * intervalo sem nenhum pacote do vizinho. Como o estado vai nos pacotes,
+ * uma falha num sentido so tambem derruba o outro lado: quem deixa de
+ * receber manda um ultimo pacote Down e o vizinho desce junto.
+ *
+ * Na queda a sessao chama Ipv4::SetDown na interface, o que o
+ * Ipv4ListRouting repassa a todos os protocolos do roteador: o Rip apaga
+ * as rotas da interface na hora; o OLSR do ns-3 ignora NotifyInterfaceDown
+ * e so troca de rota quando a vizinhanca expira, mas o ECMP e o fast-reroute
+ * (que olham IsUp) ja desviam o trafego. A volta da interface continua
+ * administrativa (UpLink); depois dela a sessao sobe de novo sozinha.
+ *
+ * Para a deteccao ter o que detectar, CutLink derruba o enlace so no meio
+ * fisico, sem avisar o IP (ver --failure nos cenarios).
+ */
+class Bfd
+{
+public:
+  Bfd ()
+    : m_multiplier (0)
+  {
+    m_jitter = CreateObject<UniformRandomVariable> ();
+  }
+
+  int64_t AssignStreams (int64_t stream)
+  {
+    m_jitter->SetStream (stream);
+    return 1;
+  }
+
+  void Install (NodeContainer routers, Time interval, uint32_t multiplier)
+  {
+    m_interval = interval;
+    m_multiplier = multiplier;
+    m_start = Simulator::Now ();
+    std::set<Ptr<Node> > members (routers.Begin (), routers.End ());
+    for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+      {
+        Ptr<Ipv4> ipv4 = (*it)->GetObject<Ipv4> ();
+        Ptr<Socket> listen = Socket::CreateSocket (*it, UdpSocketFactory::GetTypeId ());
+        listen->Bind (InetSocketAddress (Ipv4Address::GetAny (), 3784));
+        listen->SetRecvCallback (MakeCallback (&Bfd::Receive, this));
+        for (uint32_t i = 1; i < ipv4->GetNInterfaces (); i++)
+          {
+            Ptr<NetDevice> dev = ipv4->GetNetDevice (i);
+            Ptr<Channel> channel = dev->GetChannel ();
+            for (uint32_t k = 0; channel && k < channel->GetNDevices (); k++)
+              {
+                Ptr<NetDevice> peerDev = channel->GetDevice (k);
+                if (peerDev == dev || !members.count (peerDev->GetNode ()))
+                  {
+                    continue;
+                  }
+                Ptr<Ipv4> peer = peerDev->GetNode ()->GetObject<Ipv4> ();
+                Ptr<Session> s = Create<Session> ();
+                s->ipv4 = ipv4;
+                s->interface = i;
+                s->peer = peer->GetAddress (peer->GetInterfaceForDevice (peerDev), 0).GetLocal ();
+                s->myDiscriminator = m_sessions.size () + 1;
+                s->socket = Socket::CreateSocket (*it, UdpSocketFactory::GetTypeId ());
+                s->socket->Bind (InetSocketAddress (ipv4->GetAddress (i, 0).GetLocal (), 0));
+                s->socket->BindToNetDevice (dev);
+                s->socket->SetIpTtl (255);
+                s->socket->Connect (InetSocketAddress (s->peer, 3784));
+                m_sessions[std::make_pair ((*it)->GetId (), s->peer.Get ())] = s;
+                // Primeiro envio sorteado ja com o stream atribuido (AssignStreams vem depois)
+                s->txEvent = Simulator::ScheduleNow (&Bfd::Begin, this, s);
+              }
+          }
+      }
+  }
+
+  /* Sessoes, deteccoes e latencia de deteccao em relacao a falha. */
+  void Print (std::ostream &os, Time failure) const
+  {
+    double elapsed = (Simulator::Now () - m_start).GetSeconds ();
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    os << "BFD (interval=" << m_interval.GetMilliSeconds () << "ms multiplier=" << m_multiplier << ")" << std::endl;
+    for (std::map<std::pair<uint32_t, uint32_t>, Ptr<Session> >::const_iterator it = m_sessions.begin ();
+         it != m_sessions.end (); ++it)
+      {
+        Ptr<Session> s = it->second;
+        os << "  " << Names::FindName (NodeList::GetNode (it->first.first)) << "/" << s->interface << " -> " << s->peer
+           << " state=" << StateName (s->state) << " tx=" << s->txPackets << " rx=" << s->rxPackets
+           << " ups=" << s->ups << std::endl;
+        packets += s->txPackets;
+        bytes += s->txBytes;
+      }
+    Time first = Seconds (-1);
+    Time last = Seconds (-1);
+    for (std::vector<Detection>::const_iterator d = m_detections.begin (); d != m_detections.end (); ++d)
+      {
+        os << "  down " << Names::FindName (NodeList::GetNode (d->node)) << "/" << d->interface << " -> " << d->peer
+           << " at " << d->time.GetSeconds () << "s"
+           << (d->diagnostic == BfdHeader::DETECTION_TIME_EXPIRED ? " detection-time-expired" : " neighbor-down")
+           << (d->notified ? "" : " (interface already down)");
+        if (d->time >= failure)
+          {
+            os << " latency=" << (d->time - failure).GetMilliSeconds () << "ms";
+            first = first.IsNegative () ? d->time : std::min (first, d->time);
+            last = std::max (last, d->time);
+          }
+        os << std::endl;
+      }
+    os << "  sessions=" << m_sessions.size () << " controlPackets=" << packets << " controlBytes=" << bytes;
+    if (elapsed > 0 && !m_sessions.empty ())
+      {
+        os << " perSession=" << packets / elapsed / m_sessions.size () << "pps/"
+           << bytes * 8 / elapsed / m_sessions.size () << "bps";
+      }
+    if (!first.IsNegative ())
+      {
+        os << " detection=" << (first - failure).GetMilliSeconds () << "ms"
+           << " bothEnds=" << (last - failure).GetMilliSeconds () << "ms";
+      }
+    os << std::endl;
+  }
+
+private:
+  struct Session : public SimpleRefCount<Session>
+  {
+    Session ()
+      : interface (0), state (BfdHeader::DOWN), diagnostic (BfdHeader::NO_DIAGNOSTIC), myDiscriminator (0),
+        yourDiscriminator (0), txPackets (0), rxPackets (0), txBytes (0), ups (0)
+    {
+    }
+
+    Ptr<Ipv4> ipv4;
+    uint32_t interface;
+    Ipv4Address peer;
+    Ptr<Socket> socket;
+    uint8_t state;
+    uint8_t diagnostic;
+    uint32_t myDiscriminator;
+    uint32_t yourDiscriminator;
+    EventId txEvent;
+    EventId detectEvent;
+    uint64_t txPackets;
+    uint64_t rxPackets;
+    uint64_t txBytes;
+    uint32_t ups;
+  };
+
+  struct Detection
+  {
+    uint32_t node;
+    uint32_t interface;
+    Ipv4Address peer;
+    Time time;
+    uint8_t diagnostic;
+    bool notified;
+  };
+
+  static const char *StateName (uint8_t state)
+  {
+    static const char *names[] = { "AdminDown", "Down", "Init", "Up" };
+    return names[state & 3];
+  }
+
+  void Begin (Ptr<Session> s)
+  {
+    s->txEvent = Simulator::Schedule (m_interval * m_jitter->GetValue (), &Bfd::Transmit, this, s);
+  }
+
+  void Transmit (Ptr<Session> s)
+  {
+    Send (s);
+    s->txEvent = Simulator::Schedule (m_interval * (0.75 + 0.25 * m_jitter->GetValue ()), &Bfd::Transmit, this, s);
+  }
+
+  void Send (Ptr<Session> s)
+  {
+    if (!s->ipv4->IsUp (s->interface))
+      {
+        return;
+      }
+    BfdHeader h;
+    h.diagnostic = s->diagnostic;
+    h.state = s->state;
+    h.multiplier = m_multiplier;
+    h.myDiscriminator = s->myDiscriminator;
+    h.yourDiscriminator = s->yourDiscriminator;
+    h.desiredMinTx = m_interval.GetMicroSeconds ();
+    h.requiredMinRx = m_interval.GetMicroSeconds ();
+    Ptr<Packet> p = Create<Packet> ();
+    p->AddHeader (h);
+    if (s->socket->Send (p) >= 0)
+      {
+        s->txPackets++;
+        // Com os cabecalhos UDP e IP
+        s->txBytes += p->GetSize () + 8 + 20;
+      }
+  }
+
+  void Receive (Ptr<Socket> socket)
+  {
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom (from)))
+      {
+        std::map<std::pair<uint32_t, uint32_t>, Ptr<Session> >::iterator it =
+          m_sessions.find (std::make_pair (socket->GetNode ()->GetId (),
+                                           InetSocketAddress::ConvertFrom (from).GetIpv4 ().Get ()));
+        BfdHeader h;
+        if (it == m_sessions.end () || packet->RemoveHeader (h) != h.GetSerializedSize ())
+          {
+            continue;
+          }
+        Ptr<Session> s = it->second;
+        s->rxPackets++;
+        s->yourDiscriminator = h.myDiscriminator;
+        // Maquina de estados da RFC 5880, secao 6.8.6
+        if (s->state == BfdHeader::UP && h.state == BfdHeader::DOWN)
+          {
+            Down (s, BfdHeader::NEIGHBOR_SIGNALED_DOWN);
+            continue;
+          }
+        if (s->state == BfdHeader::DOWN && h.state == BfdHeader::DOWN)
+          {
+            s->state = BfdHeader::INIT;
+          }
+        else if (s->state != BfdHeader::UP && (h.state == BfdHeader::INIT || (s->state == BfdHeader::INIT
+                                                                              && h.state == BfdHeader::UP)))
+          {
+            s->state = BfdHeader::UP;
+            s->diagnostic = BfdHeader::NO_DIAGNOSTIC;
+            s->ups++;
+          }
+        if (s->state != BfdHeader::DOWN)
+          {
+            s->detectEvent.Cancel ();
+            s->detectEvent = Simulator::Schedule (m_interval * h.multiplier, &Bfd::Expire, this, s);
+          }
+      }
+  }
+
+  void Expire (Ptr<Session> s)
+  {
+    if (s->state == BfdHeader::UP)
+      {
+        Down (s, BfdHeader::DETECTION_TIME_EXPIRED);
+      }
+    else
+      {
+        s->state = BfdHeader::DOWN;
+      }
+  }
+
+  void Down (Ptr<Session> s, uint8_t diagnostic)
+  {
+    s->state = BfdHeader::DOWN;
+    s->diagnostic = diagnostic;
+    s->detectEvent.Cancel ();
+    Detection d;
+    d.node = s->ipv4->GetObject<Node> ()->GetId ();
+    d.interface = s->interface;
+    d.peer = s->peer;
+    d.time = Simulator::Now ();
+    d.diagnostic = diagnostic;
+    d.notified = s->ipv4->IsUp (s->interface);
+    m_detections.push_back (d);
+    // Avisa o vizinho antes de tirar a interface do ar
+    Send (s);
+    if (d.notified)
+      {
+        s->ipv4->SetDown (s->interface);
+      }
+  }
+
+  Time m_interval;
+  uint32_t m_multiplier;
+  Time m_start;
+  Ptr<UniformRandomVariable> m_jitter;
+  std::map<std::pair<uint32_t, uint32_t>, Ptr<Session> > m_sessions;
+  std::vector<Detection> m_detections;
+};
+
+/*
+ * Falha so no meio fisico: os devices entre nodeA e nodeB passam a descartar
+ * tudo o que recebem, sem Ipv4::SetDown. Com oneWay so o sentido A -> B se
+ * perde. Num segmento CSMA o device cortado deixa de receber do segmento
+ * inteiro. Os modelos de erro usam os streams stream e stream + 1.
+ */
+inline void
+CutLink (Ptr<Node> nodeA, Ptr<Node> nodeB, bool oneWay, int64_t stream)
+{
+  for (uint32_t i = 0; i < nodeA->GetNDevices (); i++)
+    {
+      Ptr<NetDevice> dev = nodeA->GetDevice (i);
+      Ptr<Channel> channel = dev->GetChannel ();
+      for (uint32_t k = 0; channel && k < channel->GetNDevices (); k++)
+        {
+          Ptr<NetDevice> peerDev = channel->GetDevice (k);
+          if (peerDev->GetNode () != nodeB)
+            {
+              continue;
+            }
+          std::vector<Ptr<NetDevice> > cut (1, peerDev);
+          if (!oneWay)
+            {
+              cut.push_back (dev);
+            }
+          for (std::vector<Ptr<NetDevice> >::const_iterator d = cut.begin (); d != cut.end (); ++d)
+            {
+              Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+              em->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+              em->SetRate (1.0);
+              stream += em->AssignStreams (stream);
+              (*d)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+            }
+        }
+    }
+}
+
+/*
+ * Indices de interface (IPv4 ou IPv6) de nodeA e nodeB no enlace que os
+ * liga, para a falha administrativa derrubar o mesmo enlace que o CutLink.
+ */
+inline std::pair<uint32_t, uint32_t>
+SharedLinkInterfaces (Ptr<Node> nodeA, Ptr<Node> nodeB)
+{
+  Ptr<Ipv4> ipv4A = nodeA->GetObject<Ipv4> ();
+  Ptr<Ipv6> ipv6A = nodeA->GetObject<Ipv6> ();
+  for (uint32_t i = 0; i < nodeA->GetNDevices (); i++)
+    {
+      Ptr<NetDevice> dev = nodeA->GetDevice (i);
+      Ptr<Channel> channel = dev->GetChannel ();
+      for (uint32_t k = 0; channel && k < channel->GetNDevices (); k++)
+        {
+          Ptr<NetDevice> peerDev = channel->GetDevice (k);
+          if (peerDev->GetNode () != nodeB)
+            {
+              continue;
+            }
+          int32_t a = ipv4A ? ipv4A->GetInterfaceForDevice (dev) : ipv6A->GetInterfaceForDevice (dev);
+          int32_t b = ipv4A ? nodeB->GetObject<Ipv4> ()->GetInterfaceForDevice (peerDev)
+                            : nodeB->GetObject<Ipv6> ()->GetInterfaceForDevice (peerDev);
+          if (a >= 0 && b >= 0)
+            {
+              return std::make_pair (static_cast<uint32_t> (a), static_cast<uint32_t> (b));
+            }
+        }
+    }
+  NS_ABORT_MSG ("No link between " << Names::FindName (nodeA) << " and " << Names::FindName (nodeB));
+  return std::make_pair (0u, 0u);
+}
+
+} // namespace ns3
+
+#endif /* BFD_H */
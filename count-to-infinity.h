@@ -0,0 +1,226 @@
+#ifndef COUNT_TO_INFINITY_H
+#define COUNT_TO_INFINITY_H
+
+#include <list>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/rip-header.h"
+
+namespace ns3 {
+
+/*
+ * Detector de contagem ao infinito no RIP.
+ *
+ * Acompanha a metrica anunciada por cada roteador para cada prefixo, por
+ * interface de saida (assim o 16 constante do poison reverse nao se mistura
+ * com a rota real). Um episodio comeca quando a metrica sobe e continua
+ * enquanto ela nao desce; termina ao chegar em 16 (contou ate o infinito)
+ * ou quando a metrica volta a cair (achou outro caminho). So e registrado
+ * se houve pelo menos dois aumentos: um aumento isolado e so troca de
+ * caminho, e um salto direto para 16 e a invalidacao normal da rota.
+ *
+ * Mensagens desperdicadas sao as RTEs daquele prefixo enviadas durante o
+ * episodio. O custo e um parse de cabecalho por pacote RIP transmitido.
+ */
+class CountToInfinityDetector
+{
+public:
+  void Install (NodeContainer routers)
+  {
+    for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol> ();
+        ipv4->TraceConnectWithoutContext ("Tx", MakeBoundCallback (&CountToInfinityDetector::Tx, this, (*it)->GetId ()));
+      }
+  }
+
+  void Print (std::ostream &os, std::string splitHorizon)
+  {
+    // Episodios ainda abertos no fim da simulacao tambem entram
+    for (std::map<Key, Track>::iterator it = m_tracks.begin (); it != m_tracks.end (); ++it)
+      {
+        Close (it->first, it->second, false);
+      }
+    Time total;
+    uint64_t wasted = 0;
+    uint32_t infinite = 0;
+    os << "Count-to-infinity episodes (" << splitHorizon << ")" << std::endl;
+    for (std::vector<Episode>::const_iterator e = m_episodes.begin (); e != m_episodes.end (); ++e)
+      {
+        os << "  " << Names::FindName (NodeList::GetNode (e->node)) << " " << Ipv4Address (e->prefix)
+           << " if=" << e->interface
+           << " start=" << e->start.GetSeconds () << "s"
+           << " duration=" << e->duration.GetSeconds () << "s"
+           << " metric=" << e->fromMetric << "->" << e->toMetric
+           << " steps=" << e->steps
+           << " messages=" << e->messages
+           << (e->infinity ? " reached-infinity" : "") << std::endl;
+        total += e->duration;
+        wasted += e->messages;
+        infinite += e->infinity;
+      }
+    os << "  episodes=" << m_episodes.size () << " reachedInfinity=" << infinite
+       << " totalDuration=" << total.GetSeconds () << "s wastedMessages=" << wasted << std::endl;
+  }
+
+private:
+  struct Key
+  {
+    uint32_t node;
+    uint32_t prefix;
+    uint32_t interface;
+
+    bool operator< (const Key &o) const
+    {
+      if (node != o.node)
+        {
+          return node < o.node;
+        }
+      if (prefix != o.prefix)
+        {
+          return prefix < o.prefix;
+        }
+      return interface < o.interface;
+    }
+  };
+
+  struct Track
+  {
+    Track ()
+      : metric (0), active (false), fromMetric (0), steps (0), messages (0)
+    {
+    }
+
+    uint32_t metric;
+    bool active;
+    Time start;
+    uint32_t fromMetric;
+    uint32_t steps;
+    uint64_t messages;
+  };
+
+  struct Episode
+  {
+    uint32_t node;
+    uint32_t prefix;
+    uint32_t interface;
+    Time start;
+    Time duration;
+    uint32_t fromMetric;
+    uint32_t toMetric;
+    uint32_t steps;
+    uint64_t messages;
+    bool infinity;
+  };
+
+  static void Tx (CountToInfinityDetector *detector, uint32_t node,
+                  Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    // O trace ve todo pacote enviado: filtra pelo original e so copia mensagem RIP
+    Ipv4Header ip;
+    if (!packet->PeekHeader (ip) || ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER)
+      {
+        return;
+      }
+    uint32_t ports = ip.GetSerializedSize () + 4;
+    uint8_t head[64];
+    if (packet->GetSize () < ports || ports > sizeof (head))
+      {
+        return;
+      }
+    packet->CopyData (head, ports);
+    if (((head[ports - 2] << 8) | head[ports - 1]) != 520)
+      {
+        return;
+      }
+    Ptr<Packet> copy = packet->Copy ();
+    copy->RemoveHeader (ip);
+    UdpHeader udp;
+    copy->RemoveHeader (udp);
+    RipHeader rip;
+    copy->RemoveHeader (rip);
+    if (rip.GetCommand () != RipHeader::RESPONSE)
+      {
+        return;
+      }
+    std::list<RipRte> rtes = rip.GetRteList ();
+    for (std::list<RipRte>::const_iterator r = rtes.begin (); r != rtes.end (); ++r)
+      {
+        Key key;
+        key.node = node;
+        key.prefix = r->GetPrefix ().Get ();
+        key.interface = interface;
+        detector->Update (key, r->GetRouteMetric ());
+      }
+  }
+
+  void Update (const Key &key, uint32_t metric)
+  {
+    std::map<Key, Track>::iterator it = m_tracks.find (key);
+    if (it == m_tracks.end ())
+      {
+        m_tracks[key].metric = metric;
+        return;
+      }
+    Track &t = it->second;
+    if (t.active)
+      {
+        t.messages++;
+      }
+    if (metric > t.metric && metric < 16)
+      {
+        if (!t.active)
+          {
+            t.active = true;
+            t.start = Simulator::Now ();
+            t.fromMetric = t.metric;
+            t.steps = 0;
+            t.messages = 1;
+          }
+        t.steps++;
+      }
+    else if (metric >= 16 && t.active)
+      {
+        t.metric = metric;
+        Close (key, t, true);
+      }
+    else if (metric < t.metric)
+      {
+        Close (key, t, false);
+      }
+    t.metric = metric;
+  }
+
+  void Close (const Key &key, Track &t, bool infinity)
+  {
+    if (t.active && t.steps >= 2)
+      {
+        Episode e;
+        e.node = key.node;
+        e.prefix = key.prefix;
+        e.interface = key.interface;
+        e.start = t.start;
+        e.duration = Simulator::Now () - t.start;
+        e.fromMetric = t.fromMetric;
+        e.toMetric = t.metric;
+        e.steps = t.steps;
+        e.messages = t.messages;
+        e.infinity = infinity;
+        m_episodes.push_back (e);
+      }
+    t.active = false;
+  }
+
+  std::map<Key, Track> m_tracks;
+  std::vector<Episode> m_episodes;
+};
+
+} // namespace ns3
+
+#endif /* COUNT_TO_INFINITY_H */
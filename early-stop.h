@@ -0,0 +1,280 @@
+#ifndef EARLY_STOP_H
+#define EARLY_STOP_H
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/*
+ * Termino antecipado: depois da falha, encerra a simulacao assim que o
+ * roteamento reconvergiu e o fluxo voltou, os dois estaveis por hold.
+ *
+ *   roteamento  nenhum roteador trocou o proximo salto (gateway, interface)
+ *               para as sub-redes do destino do fluxo durante hold;
+ *               amostrado pelo RouteOutput, como no RipAccounting, entao
+ *               vale para RIP, RIPng e OLSR. Sao as rotas que decidem a
+ *               volta do fluxo; sondar todas as sub-redes da topologia em
+ *               todo roteador custava roteadores x sub-redes por amostra
+ *   fluxo       entregas no destino (UDP para a porta do fluxo ou echo
+ *               request ICMP/ICMPv6) ha pelo menos hold, sem intervalo
+ *               maior que maxGap entre elas
+ *
+ * As amostras comecam na falha, a cada hold/10 (no maximo 0.5 s). O tempo
+ * economizado e o que faltava ate o Simulator::Stop agendado; o de relogio
+ * e estimado pelo ritmo da execucao ate a parada.
+ */
+class ConvergenceStop
+{
+public:
+  ConvergenceStop ()
+    : m_port (0), m_stopped (false), m_savedWall (0)
+  {
+  }
+
+  void Install (NodeContainer routers, Ptr<Node> dst, uint16_t port, Time failure, Time hold, Time maxGap,
+                Time scheduledStop)
+  {
+    m_dst = dst;
+    m_port = port;
+    m_failure = failure;
+    m_hold = hold;
+    m_maxGap = maxGap;
+    m_scheduledStop = scheduledStop;
+    m_lastChange = failure;
+    m_flowSince = Seconds (-1);
+    m_lastDelivery = Seconds (-1);
+    for (NodeContainer::Iterator n = routers.Begin (); n != routers.End (); ++n)
+      {
+        Router r;
+        r.node = *n;
+        m_routers.push_back (r);
+      }
+    if (dst->GetObject<Ipv4L3Protocol> ())
+      {
+        dst->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+          "LocalDeliver", MakeCallback (&ConvergenceStop::Ipv4Deliver, this));
+      }
+    if (dst->GetObject<Ipv6L3Protocol> ())
+      {
+        dst->GetObject<Ipv6L3Protocol> ()->TraceConnectWithoutContext (
+          "LocalDeliver", MakeCallback (&ConvergenceStop::Ipv6Deliver, this));
+      }
+    gettimeofday (&m_start, 0);
+    Simulator::Schedule (failure, &ConvergenceStop::Poll, this);
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Early stop (hold " << m_hold.GetSeconds () << "s): ";
+    if (m_stopped)
+      {
+        os << "stopped at " << m_stopAt.GetSeconds () << "s, routes stable since " << m_lastChange.GetSeconds ()
+           << "s, flow back since " << m_flowSince.GetSeconds () << "s; saved " << SavedSeconds ()
+           << "s of " << m_scheduledStop.GetSeconds () << "s simulated (~" << m_savedWall << "s wall)" << std::endl;
+      }
+    else
+      {
+        os << "not reached, routes last changed at " << m_lastChange.GetSeconds () << "s, ";
+        if (m_flowSince.IsNegative ())
+          {
+            os << "flow not back" << std::endl;
+          }
+        else
+          {
+            os << "flow back since " << m_flowSince.GetSeconds () << "s" << std::endl;
+          }
+      }
+  }
+
+  /* Para o registro de resultado (result-record.h). */
+  std::string ToJson (void) const
+  {
+    std::ostringstream os;
+    os << "{\"stopped\": " << (m_stopped ? "true" : "false")
+       << ", \"stop_s\": " << (m_stopped ? m_stopAt : m_scheduledStop).GetSeconds ()
+       << ", \"scheduled_stop_s\": " << m_scheduledStop.GetSeconds ()
+       << ", \"saved_s\": " << SavedSeconds () << ", \"saved_wall_s\": " << m_savedWall
+       << ", \"routes_stable_s\": " << m_lastChange.GetSeconds ()
+       << ", \"flow_back_s\": " << m_flowSince.GetSeconds () << "}";
+    return os.str ();
+  }
+
+private:
+  struct Router
+  {
+    Ptr<Node> node;
+    std::vector<std::pair<uint32_t, int32_t> > hops;
+    std::vector<std::pair<Ipv6Address, int32_t> > hops6;
+  };
+
+  double SavedSeconds (void) const
+  {
+    return m_stopped ? (m_scheduledStop - m_stopAt).GetSeconds () : 0.0;
+  }
+
+  void Deliver (Ptr<const Packet> packet, uint8_t protocol)
+  {
+    UdpHeader udp;
+    Icmpv4Header icmp;
+    Icmpv6Header icmp6;
+    bool flow = (protocol == UdpL4Protocol::PROT_NUMBER && packet->PeekHeader (udp)
+                 && udp.GetDestinationPort () == m_port)
+                || (protocol == Icmpv4L4Protocol::PROT_NUMBER && packet->PeekHeader (icmp)
+                    && icmp.GetType () == Icmpv4Header::ICMPV4_ECHO)
+                || (protocol == Icmpv6L4Protocol::PROT_NUMBER && packet->PeekHeader (icmp6)
+                    && icmp6.GetType () == Icmpv6Header::ICMPV6_ECHO_REQUEST);
+    Time now = Simulator::Now ();
+    if (!flow || now < m_failure)
+      {
+        return;
+      }
+    if (m_flowSince.IsNegative () || now - m_lastDelivery > m_maxGap)
+      {
+        m_flowSince = now;
+      }
+    m_lastDelivery = now;
+  }
+
+  void Ipv4Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Deliver (packet, header.GetProtocol ());
+  }
+
+  void Ipv6Deliver (const Ipv6Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Deliver (packet, header.GetNextHeader ());
+  }
+
+  /* Sub-redes das interfaces do destino do fluxo. */
+  void Subnets (void)
+  {
+    Ptr<Ipv4> ipv4 = m_dst->GetObject<Ipv4> ();
+    for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+      {
+        for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+          {
+            Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+            m_subnets.push_back (addr.GetLocal ().CombineMask (addr.GetMask ()).Get ());
+          }
+      }
+    Ptr<Ipv6> ipv6 = m_dst->GetObject<Ipv6> ();
+    for (uint32_t i = 1; ipv6 && i < ipv6->GetNInterfaces (); i++)
+      {
+        for (uint32_t j = 0; j < ipv6->GetNAddresses (i); j++)
+          {
+            Ipv6InterfaceAddress addr = ipv6->GetAddress (i, j);
+            if (addr.GetScope () == Ipv6InterfaceAddress::GLOBAL)
+              {
+                m_subnets6.push_back (addr.GetAddress ().CombinePrefix (addr.GetPrefix ()));
+              }
+          }
+      }
+    std::sort (m_subnets.begin (), m_subnets.end ());
+    m_subnets.erase (std::unique (m_subnets.begin (), m_subnets.end ()), m_subnets.end ());
+    std::sort (m_subnets6.begin (), m_subnets6.end ());
+    m_subnets6.erase (std::unique (m_subnets6.begin (), m_subnets6.end ()), m_subnets6.end ());
+  }
+
+  /* Proximos saltos atuais do roteador; true se mudaram desde a amostra anterior. */
+  bool Sample (Router &r)
+  {
+    std::vector<std::pair<uint32_t, int32_t> > hops;
+    std::vector<std::pair<Ipv6Address, int32_t> > hops6;
+    Socket::SocketErrno err;
+    Ptr<Ipv4> ipv4 = r.node->GetObject<Ipv4> ();
+    for (uint32_t s = 0; ipv4 && ipv4->GetRoutingProtocol () && s < m_subnets.size (); s++)
+      {
+        Ipv4Header header;
+        header.SetDestination (Ipv4Address (m_subnets[s]));
+        Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol ()->RouteOutput (Create<Packet> (), header, 0, err);
+        std::pair<uint32_t, int32_t> hop (0, -1);
+        if (route)
+          {
+            hop = std::make_pair (route->GetGateway ().Get (), ipv4->GetInterfaceForDevice (route->GetOutputDevice ()));
+          }
+        hops.push_back (hop);
+      }
+    Ptr<Ipv6> ipv6 = r.node->GetObject<Ipv6> ();
+    for (uint32_t s = 0; ipv6 && ipv6->GetRoutingProtocol () && s < m_subnets6.size (); s++)
+      {
+        Ipv6Header header;
+        header.SetDestinationAddress (m_subnets6[s]);
+        Ptr<Ipv6Route> route = ipv6->GetRoutingProtocol ()->RouteOutput (Create<Packet> (), header, 0, err);
+        std::pair<Ipv6Address, int32_t> hop (Ipv6Address::GetAny (), -1);
+        if (route)
+          {
+            hop = std::make_pair (route->GetGateway (), ipv6->GetInterfaceForDevice (route->GetOutputDevice ()));
+          }
+        hops6.push_back (hop);
+      }
+    bool changed = hops != r.hops || hops6 != r.hops6;
+    r.hops.swap (hops);
+    r.hops6.swap (hops6);
+    return changed;
+  }
+
+  void Poll (void)
+  {
+    Time now = Simulator::Now ();
+    bool first = m_subnets.empty () && m_subnets6.empty ();
+    if (first)
+      {
+        Subnets ();
+      }
+    bool changed = false;
+    for (std::vector<Router>::iterator r = m_routers.begin (); r != m_routers.end (); ++r)
+      {
+        changed = Sample (*r) || changed;
+      }
+    if (changed && !first)
+      {
+        m_lastChange = now;
+      }
+    if (!m_lastDelivery.IsNegative () && now - m_lastDelivery > m_maxGap)
+      {
+        m_flowSince = Seconds (-1);
+      }
+    if (now - m_lastChange >= m_hold && !m_flowSince.IsNegative () && now - m_flowSince >= m_hold)
+      {
+        m_stopped = true;
+        m_stopAt = now;
+        struct timeval end;
+        gettimeofday (&end, 0);
+        double wall = (end.tv_sec - m_start.tv_sec) + (end.tv_usec - m_start.tv_usec) / 1e6;
+        m_savedWall = now.IsStrictlyPositive () ? wall / now.GetSeconds () * SavedSeconds () : 0.0;
+        Simulator::Stop ();
+        return;
+      }
+    Simulator::Schedule (Seconds (std::min (m_hold.GetSeconds () / 10, 0.5)), &ConvergenceStop::Poll, this);
+  }
+
+  Ptr<Node> m_dst;
+  uint16_t m_port;
+  Time m_failure;
+  Time m_hold;
+  Time m_maxGap;
+  Time m_scheduledStop;
+  Time m_lastChange;
+  Time m_flowSince;
+  Time m_lastDelivery;
+  Time m_stopAt;
+  bool m_stopped;
+  double m_savedWall;
+  struct timeval m_start;
+  std::vector<Router> m_routers;
+  std::vector<uint32_t> m_subnets;
+  std::vector<Ipv6Address> m_subnets6;
+};
+
+} // namespace ns3
+
+#endif /* EARLY_STOP_H */
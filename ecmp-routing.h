@@ -0,0 +1,213 @@
+#ifndef ECMP_ROUTING_H
+#define ECMP_ROUTING_H
+
+#include <cstring>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "neighbour-costs.h"
+
+namespace ns3 {
+
+/*
+ * Multicaminho de custo igual (ECMP) com hash por fluxo.
+ *
+ * O Rip e o OLSR do ns-3 guardam um unico proximo salto por destino. Esta
+ * camada entra no Ipv4ListRouting com prioridade acima do protocolo e, para
+ * cada pacote, escolhe entre todos os proximos saltos de custo minimo pelo
+ * hash de (origem, destino, protocolo, portas, no), de modo que um fluxo
+ * sempre segue o mesmo caminho e fluxos diferentes se espalham pela malha.
+ *
+ * Os custos vem do proprio protocolo (ver NeighbourCosts); os candidatos
+ * sao os vizinhos de distancia minima ate o destino.
+ *
+ * Destinos diretamente conectados, multicast/broadcast e sockets presos a
+ * uma interface seguem para o protocolo de baixo, assim como destinos sem
+ * nenhum candidato.
+ */
+class EcmpRouting : public Ipv4RoutingProtocol
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::EcmpRouting")
+      .SetParent<Ipv4RoutingProtocol> ()
+      .SetGroupName ("Internet")
+      .AddConstructor<EcmpRouting> ();
+    return tid;
+  }
+
+  /*
+   * Acrescenta a camada ECMP ao Ipv4ListRouting de cada roteador. Com OLSR,
+   * um destino que nao e endereco de um no OLSR e procurado na sub-rede de
+   * mascara subnetMask.
+   */
+  static void Install (NodeContainer routers, Ipv4Mask subnetMask = Ipv4Mask ("255.255.255.0"))
+  {
+    for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+      {
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> ((*it)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+        NS_ABORT_MSG_UNLESS (list, "ECMP needs Ipv4ListRouting on " << Names::FindName (*it));
+        Ptr<EcmpRouting> ecmp = CreateObject<EcmpRouting> ();
+        ecmp->m_subnetMask = subnetMask;
+        list->AddRoutingProtocol (ecmp, 20);
+      }
+  }
+
+  EcmpRouting ()
+    : m_subnetMask (Ipv4Mask ("255.255.255.0")),
+      m_selected (0)
+  {
+  }
+
+  Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                              Socket::SocketErrno &sockerr)
+  {
+    Ipv4Address dest = header.GetDestination ();
+    if (oif || dest.IsMulticast () || dest.IsBroadcast ())
+      {
+        return 0;
+      }
+    std::vector<NeighbourCosts::Cost> hops = GetNextHops (dest);
+    if (hops.empty ())
+      {
+        return 0;
+      }
+    sockerr = Socket::ERROR_NOTERROR;
+    return MakeRoute (dest, Select (hops, p, header));
+  }
+
+  bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                   UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                   LocalDeliverCallback lcb, ErrorCallback ecb)
+  {
+    Ipv4Address dest = header.GetDestination ();
+    if (dest.IsMulticast () || dest.IsBroadcast ()
+        || !m_ipv4->IsForwarding (m_ipv4->GetInterfaceForDevice (idev)))
+      {
+        return false;
+      }
+    std::vector<NeighbourCosts::Cost> hops = GetNextHops (dest);
+    if (hops.empty ())
+      {
+        return false;
+      }
+    ucb (MakeRoute (dest, Select (hops, p, header)), p, header);
+    return true;
+  }
+
+  void NotifyInterfaceUp (uint32_t interface)
+  {
+  }
+
+  void NotifyInterfaceDown (uint32_t interface)
+  {
+  }
+
+  void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void SetIpv4 (Ptr<Ipv4> ipv4)
+  {
+    m_ipv4 = ipv4;
+    m_costs.SetIpv4 (ipv4);
+  }
+
+  void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
+  {
+    *stream->GetStream () << "ECMP: " << m_selected << " packets routed over equal-cost next hops"
+                          << std::endl;
+  }
+
+  void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+  {
+    PrintRoutingTable (stream);
+  }
+
+private:
+  std::vector<NeighbourCosts::Cost> GetNextHops (Ipv4Address dest)
+  {
+    std::vector<NeighbourCosts::Cost> hops;
+    if (m_costs.IsConnected (dest))
+      {
+        return hops;
+      }
+    std::vector<NeighbourCosts::Cost> costs = m_costs.Get (dest);
+    if (costs.empty ())
+      {
+        costs = m_costs.Get (dest, m_subnetMask);
+      }
+    uint32_t best = NeighbourCosts::Min (costs);
+    for (std::vector<NeighbourCosts::Cost>::const_iterator c = costs.begin (); c != costs.end (); ++c)
+      {
+        if (c->distance == best)
+          {
+            hops.push_back (*c);
+          }
+      }
+    return hops;
+  }
+
+  const NeighbourCosts::Cost &Select (const std::vector<NeighbourCosts::Cost> &hops, Ptr<const Packet> p,
+                                     const Ipv4Header &header)
+  {
+    if (hops.size () > 1)
+      {
+        m_selected++;
+      }
+    uint16_t ports[2] = { 0, 0 };
+    if (p && header.GetProtocol () == UdpL4Protocol::PROT_NUMBER)
+      {
+        UdpHeader udp;
+        if (p->PeekHeader (udp))
+          {
+            ports[0] = udp.GetSourcePort ();
+            ports[1] = udp.GetDestinationPort ();
+          }
+      }
+    else if (p && header.GetProtocol () == TcpL4Protocol::PROT_NUMBER)
+      {
+        TcpHeader tcp;
+        if (p->PeekHeader (tcp))
+          {
+            ports[0] = tcp.GetSourcePort ();
+            ports[1] = tcp.GetDestinationPort ();
+          }
+      }
+    // O id do no entra no hash para roteadores em sequencia nao escolherem
+    // sempre o mesmo indice (polarizacao)
+    uint32_t key[5] = { header.GetSource ().Get (), header.GetDestination ().Get (), header.GetProtocol (),
+                        (uint32_t (ports[0]) << 16) | ports[1], m_ipv4->GetObject<Node> ()->GetId () };
+    char buffer[sizeof (key)];
+    std::memcpy (buffer, key, sizeof (key));
+    return hops[Hash32 (buffer, sizeof (buffer)) % hops.size ()];
+  }
+
+  Ptr<Ipv4Route> MakeRoute (Ipv4Address dest, const NeighbourCosts::Cost &hop)
+  {
+    Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+    route->SetDestination (dest);
+    route->SetGateway (hop.gateway);
+    route->SetOutputDevice (m_ipv4->GetNetDevice (hop.interface));
+    route->SetSource (m_ipv4->GetAddress (hop.interface, 0).GetLocal ());
+    return route;
+  }
+
+  Ptr<Ipv4> m_ipv4;
+  NeighbourCosts m_costs;
+  Ipv4Mask m_subnetMask;
+  uint64_t m_selected;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (EcmpRouting);
+
+} // namespace ns3
+
+#endif /* ECMP_ROUTING_H */
@@ -0,0 +1,139 @@
+#ifndef EMULATION_H
+#define EMULATION_H
+
+#include <algorithm>
+#include <iostream>
+#include <ostream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/tap-bridge-module.h"
+#include "ns3/constant-position-mobility-model.h"
+
+namespace ns3 {
+
+/*
+ * Modo de emulacao: simulador em tempo real e hosts locais ligados aos
+ * segmentos CSMA dos nos T e R por dispositivos tap.
+ *
+ * Deve ser chamado antes de qualquer uso do Simulator, senao a implementacao
+ * padrao ja foi criada. Checksums ligados porque os pacotes saem do ns-3.
+ */
+inline void
+EnableRealtime (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::RealtimeSimulatorImpl"));
+  GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
+}
+
+/*
+ * Acrescenta ao mesmo canal CSMA de segment uma estacao "fantasma" cujo
+ * dispositivo e ligado por TapBridge ao tap tapName do Linux. Para o resto da
+ * topologia o host local e so mais um endereco na sub-rede do segmento
+ * (network + hostBase), entao o RIP ja anuncia a rota para ele.
+ *
+ * Em ConfigureLocal o tap e criado pelo ns-3 (tap-creator precisa de suid
+ * root) com o IP e o MAC da estacao; o host ainda precisa de uma rota para o
+ * resto da topologia via o roteador do segmento. Com os dois taps na mesma
+ * maquina o kernel entrega localmente o trafego entre eles; para que ele
+ * atravesse a topologia use UseBridge com cada tap numa bridge/namespace.
+ */
+inline Ptr<Node>
+AttachTapHost (Ptr<NetDevice> segment, std::string tapName, std::string mode,
+               Ipv4Address network, Ipv4Mask mask, Ipv4Address hostBase, Vector position)
+{
+  Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel> (segment->GetChannel ());
+  NS_ABORT_MSG_UNLESS (channel, "TapBridge needs a CSMA segment");
+
+  Ptr<Node> ghost = CreateObject<Node> ();
+  Names::Add (tapName, ghost);
+  CsmaHelper csma;
+  NetDeviceContainer device = csma.Install (ghost, channel);
+
+  InternetStackHelper stack;
+  stack.SetIpv6StackInstall (false);
+  stack.Install (ghost);
+  Ipv4AddressHelper address;
+  address.SetBase (network, mask, hostBase);
+  Ipv4InterfaceContainer iic = address.Assign (device);
+
+  TapBridgeHelper tapBridge;
+  tapBridge.SetAttribute ("Mode", StringValue (mode));
+  tapBridge.SetAttribute ("DeviceName", StringValue (tapName));
+  tapBridge.Install (ghost, device.Get (0));
+
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (position);
+  ghost->AggregateObject (mobility);
+
+  std::cout << "Tap " << tapName << " (" << mode << ") " << iic.GetAddress (0)
+            << " on segment of " << Names::FindName (segment->GetNode ()) << std::endl;
+  return ghost;
+}
+
+/*
+ * Atraso do escalonador em modo tempo real: a cada intervalo compara o tempo
+ * de parede decorrido desde a primeira amostra com o tempo simulado desde
+ * ela. O relogio parte na primeira amostra, ja dentro do Simulator::Run,
+ * para o tempo de montagem do cenario nao entrar como lag. Lag positivo
+ * significa que a simulacao esta atrasada em relacao ao relogio.
+ */
+class RealtimeLagMonitor
+{
+public:
+  RealtimeLagMonitor ()
+    : m_started (false), m_samples (0), m_late (0), m_sumMs (0), m_maxMs (0), m_thresholdMs (10)
+  {
+  }
+
+  void Start (Time interval)
+  {
+    m_interval = interval;
+    Simulator::ScheduleNow (&RealtimeLagMonitor::Sample, this);
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Realtime scheduler lag: samples=" << m_samples
+       << " mean=" << (m_samples ? m_sumMs / m_samples : 0) << "ms"
+       << " max=" << m_maxMs << "ms"
+       << " over" << m_thresholdMs << "ms=" << m_late << std::endl;
+  }
+
+private:
+  void Sample (void)
+  {
+    if (!m_started)
+      {
+        m_started = true;
+        m_origin = Simulator::Now ();
+        m_clock.Start ();
+      }
+    double lagMs = m_clock.End () - (Simulator::Now () - m_origin).GetMilliSeconds ();
+    m_samples++;
+    m_sumMs += lagMs;
+    m_maxMs = std::max (m_maxMs, lagMs);
+    if (lagMs > m_thresholdMs)
+      {
+        m_late++;
+      }
+    Simulator::Schedule (m_interval, &RealtimeLagMonitor::Sample, this);
+  }
+
+  SystemWallClockMs m_clock;
+  bool m_started;
+  Time m_origin;
+  Time m_interval;
+  uint64_t m_samples;
+  uint64_t m_late;
+  double m_sumMs;
+  double m_maxMs;
+  double m_thresholdMs;
+};
+
+} // namespace ns3
+
+#endif /* EMULATION_H */
@@ -0,0 +1,374 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/olsr-routing-protocol.h"
+
+/*
+ * Nivel maximo de eventos compilado. Eventos acima deste nivel somem do
+ * binario (o if abaixo e constante), entao um build otimizado com
+ * -DEVENT_LOG_LEVEL=0 nao paga nada pelo log.
+ *
+ *   1  falhas de enlace, descartes, mudancas de tabela
+ *   2  mensagens de controle (RIP, OLSR)
+ *   3  todo pacote IPv4 enviado/recebido
+ */
+#ifndef EVENT_LOG_LEVEL
+#define EVENT_LOG_LEVEL 2
+#endif
+
+#define EVENT_LOG(level, component, node, event, a, b, c)                          \
+  do                                                                               \
+    {                                                                              \
+      if ((level) <= EVENT_LOG_LEVEL)                                              \
+        {                                                                          \
+          ns3::EventLog::Get ()->Write ((component), (node), (event), (a), (b), (c)); \
+        }                                                                          \
+    }                                                                              \
+  while (0)
+
+namespace ns3 {
+
+/*
+ * Log binario de eventos, substituto do LogComponentEnableAll.
+ *
+ * Cada registro tem 28 bytes (little-endian):
+ *
+ *   int64 tempo (ns) | uint32 no | uint16 componente | uint16 evento | uint32 a, b, c
+ *
+ * precedidos por um cabecalho "EVLG" + versao. O significado de a, b, c
+ * depende do evento (ver tools/event-log-decode.py, que converte o arquivo
+ * para texto). Filtros de componente e de no sao aplicados na instalacao:
+ * nada e conectado para o que foi filtrado. A janela de tempo e conferida
+ * em cada registro.
+ */
+class EventLog
+{
+public:
+  enum Component
+  {
+    SCENARIO = 0,
+    IPV4 = 1,
+    RIP = 2,
+    OLSR = 3,
+    ARP = 4,
+    QUEUE = 5
+  };
+
+  enum Event
+  {
+    // SCENARIO: a = no vizinho, b = interface local, c = interface do vizinho
+    LINK_DOWN = 1,
+    LINK_UP = 2,
+    // IPV4: a = origem, b = destino, c = tamanho (DROP: c = motivo)
+    TX = 1,
+    RX = 2,
+    DROP = 3,
+    // RIP/OLSR TX/RX: a = par, b = tamanho ou numero de mensagens, c = interface
+    // OLSR TABLE_CHANGED: a = numero de rotas
+    TABLE_CHANGED = 4
+    // ARP DROP, QUEUE DROP: a = tamanho, b = interface
+  };
+
+  static EventLog *Get (void)
+  {
+    static EventLog log;
+    return &log;
+  }
+
+  /* Componentes separados por virgula (Ipv4,Rip,Olsr,Arp,Queue); vazio = todos. */
+  void SetComponents (std::string components)
+  {
+    m_components = components.empty () ? ~0u : 1u << SCENARIO;
+    std::istringstream in (components);
+    std::string name;
+    while (std::getline (in, name, ','))
+      {
+        m_components |= 1u << ComponentFromName (name);
+      }
+  }
+
+  /* Ids de no separados por virgula; vazio = todos. */
+  void SetNodes (std::string nodes)
+  {
+    std::istringstream in (nodes);
+    std::string id;
+    while (std::getline (in, id, ','))
+      {
+        m_nodes.insert (std::atoi (id.c_str ()));
+      }
+  }
+
+  void SetWindow (Time start, Time stop)
+  {
+    m_start = start;
+    m_stop = stop;
+  }
+
+  void Open (std::string fileName)
+  {
+    m_file = std::fopen (fileName.c_str (), "wb");
+    NS_ABORT_MSG_UNLESS (m_file, "Cannot open event log " << fileName);
+    static char buffer[1 << 16];
+    std::setvbuf (m_file, buffer, _IOFBF, sizeof (buffer));
+    uint32_t version = 1;
+    std::fwrite ("EVLG", 1, 4, m_file);
+    std::fwrite (&version, sizeof (version), 1, m_file);
+  }
+
+  void Close (void)
+  {
+    if (m_file)
+      {
+        std::fclose (m_file);
+        m_file = 0;
+      }
+  }
+
+  /* Conecta os trace sources dos nos selecionados. */
+  void Install (NodeContainer nodes)
+  {
+    if (!m_file)
+      {
+        return;
+      }
+    for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+      {
+        if (!IsNodeEnabled ((*it)->GetId ()))
+          {
+            continue;
+          }
+        Ptr<NodeHooks> hooks = Create<NodeHooks> ((*it)->GetId ());
+        m_hooks.push_back (hooks);
+        Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol> ();
+        if (ipv4)
+          {
+#if EVENT_LOG_LEVEL >= 1
+            if (IsEnabled (IPV4))
+              {
+                ipv4->TraceConnectWithoutContext ("Drop", MakeCallback (&NodeHooks::Ipv4Drop, hooks));
+              }
+            for (uint32_t i = 0; IsEnabled (ARP) && i < ipv4->GetNInterfaces (); i++)
+              {
+                Ptr<ArpCache> cache = ipv4->GetInterface (i)->GetArpCache ();
+                if (cache)
+                  {
+                    cache->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&NodeHooks::ArpDrop, hooks, i));
+                  }
+              }
+#endif
+#if EVENT_LOG_LEVEL >= 2
+            // Os ganchos de pacote so valem onde ha RIP (ou no nivel 3, que loga todo pacote IPv4)
+            Ptr<Rip> rip = Ipv4RoutingHelper::GetRouting<Rip> (ipv4->GetRoutingProtocol ());
+            if ((rip && IsEnabled (RIP)) || (EVENT_LOG_LEVEL >= 3 && IsEnabled (IPV4)))
+              {
+                ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&NodeHooks::Ipv4Tx, hooks));
+                ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&NodeHooks::Ipv4Rx, hooks));
+              }
+#endif
+            Ptr<olsr::RoutingProtocol> olsr = Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+            if (olsr && IsEnabled (OLSR))
+              {
+#if EVENT_LOG_LEVEL >= 1
+                olsr->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&NodeHooks::OlsrTableChanged, hooks));
+#endif
+#if EVENT_LOG_LEVEL >= 2
+                olsr->TraceConnectWithoutContext ("Tx", MakeCallback (&NodeHooks::OlsrTx, hooks));
+                olsr->TraceConnectWithoutContext ("Rx", MakeCallback (&NodeHooks::OlsrRx, hooks));
+#endif
+              }
+          }
+#if EVENT_LOG_LEVEL >= 1
+        for (uint32_t i = 0; IsEnabled (QUEUE) && i < (*it)->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = (*it)->GetDevice (i);
+            Ptr<Queue<Packet> > queue;
+            if (DynamicCast<CsmaNetDevice> (dev))
+              {
+                queue = DynamicCast<CsmaNetDevice> (dev)->GetQueue ();
+              }
+            else if (DynamicCast<PointToPointNetDevice> (dev))
+              {
+                queue = DynamicCast<PointToPointNetDevice> (dev)->GetQueue ();
+              }
+            if (queue)
+              {
+                queue->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&NodeHooks::QueueDrop, hooks, i));
+              }
+          }
+#endif
+      }
+  }
+
+  bool IsEnabled (Component component) const
+  {
+    return m_file && (m_components & (1u << component));
+  }
+
+  bool IsNodeEnabled (uint32_t node) const
+  {
+    return m_nodes.empty () || m_nodes.count (node);
+  }
+
+  void Write (Component component, uint32_t node, Event event, uint32_t a, uint32_t b, uint32_t c)
+  {
+    if (!IsEnabled (component) || !IsNodeEnabled (node))
+      {
+        return;
+      }
+    Time now = Simulator::Now ();
+    if (now < m_start || (!m_stop.IsZero () && now > m_stop))
+      {
+        return;
+      }
+    unsigned char record[28];
+    int64_t ns = now.GetNanoSeconds ();
+    uint16_t comp = component;
+    uint16_t ev = event;
+    std::memcpy (record, &ns, 8);
+    std::memcpy (record + 8, &node, 4);
+    std::memcpy (record + 12, &comp, 2);
+    std::memcpy (record + 14, &ev, 2);
+    std::memcpy (record + 16, &a, 4);
+    std::memcpy (record + 20, &b, 4);
+    std::memcpy (record + 24, &c, 4);
+    std::fwrite (record, sizeof (record), 1, m_file);
+  }
+
+private:
+  EventLog ()
+    : m_file (0), m_components (~0u)
+  {
+  }
+
+  ~EventLog ()
+  {
+    Close ();
+  }
+
+  static Component ComponentFromName (std::string name)
+  {
+    if (name == "Ipv4")
+      {
+        return IPV4;
+      }
+    if (name == "Rip")
+      {
+        return RIP;
+      }
+    if (name == "Olsr")
+      {
+        return OLSR;
+      }
+    if (name == "Arp")
+      {
+        return ARP;
+      }
+    if (name == "Queue")
+      {
+        return QUEUE;
+      }
+    NS_ABORT_MSG ("Unknown event log component " << name << " (Ipv4, Rip, Olsr, Arp, Queue)");
+    return SCENARIO;
+  }
+
+  struct NodeHooks : public SimpleRefCount<NodeHooks>
+  {
+    NodeHooks (uint32_t id)
+      : node (id)
+    {
+    }
+
+    void Ipv4Tx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      Ipv4Packet (TX, packet, interface);
+    }
+
+    void Ipv4Rx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      Ipv4Packet (RX, packet, interface);
+    }
+
+    /* Cabecalho IP e porta UDP lidos no proprio pacote, sem copia. */
+    void Ipv4Packet (Event event, Ptr<const Packet> packet, uint32_t interface)
+    {
+#if EVENT_LOG_LEVEL >= 2
+      Ipv4Header ip;
+      if (!packet->PeekHeader (ip))
+        {
+          return;
+        }
+      EVENT_LOG (3, IPV4, node, event, ip.GetSource ().Get (), ip.GetDestination ().Get (), packet->GetSize ());
+      uint8_t head[64];
+      uint32_t end = ip.GetSerializedSize () + 4;
+      if (ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER || packet->GetSize () < end || end > sizeof (head))
+        {
+          return;
+        }
+      packet->CopyData (head, end);
+      if (((head[end - 2] << 8) | head[end - 1]) == 520)
+        {
+          Ipv4Address peer = event == TX ? ip.GetDestination () : ip.GetSource ();
+          EVENT_LOG (2, RIP, node, event, peer.Get (), packet->GetSize (), interface);
+        }
+#endif
+    }
+
+    void Ipv4Drop (const Ipv4Header &ip, Ptr<const Packet> packet, Ipv4L3Protocol::DropReason reason,
+                   Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      EVENT_LOG (1, IPV4, node, DROP, ip.GetSource ().Get (), ip.GetDestination ().Get (), reason);
+    }
+
+    static void ArpDrop (Ptr<NodeHooks> hooks, uint32_t interface, Ptr<const Packet> packet)
+    {
+      EVENT_LOG (1, ARP, hooks->node, DROP, packet->GetSize (), interface, 0);
+    }
+
+    static void QueueDrop (Ptr<NodeHooks> hooks, uint32_t device, Ptr<const Packet> packet)
+    {
+      EVENT_LOG (1, QUEUE, hooks->node, DROP, packet->GetSize (), device, 0);
+    }
+
+    void OlsrTableChanged (uint32_t size)
+    {
+      EVENT_LOG (1, OLSR, node, TABLE_CHANGED, size, 0, 0);
+    }
+
+    void OlsrTx (const olsr::PacketHeader &header, const olsr::MessageList &messages)
+    {
+      EVENT_LOG (2, OLSR, node, TX, 0, messages.size (), header.GetPacketSequenceNumber ());
+    }
+
+    void OlsrRx (const olsr::PacketHeader &header, const olsr::MessageList &messages)
+    {
+      uint32_t origin = messages.empty () ? 0 : messages.front ().GetOriginatorAddress ().Get ();
+      EVENT_LOG (2, OLSR, node, RX, origin, messages.size (), header.GetPacketSequenceNumber ());
+    }
+
+    uint32_t node;
+  };
+
+  std::FILE *m_file;
+  uint32_t m_components;
+  std::set<uint32_t> m_nodes;
+  Time m_start;
+  Time m_stop;
+  std::vector<Ptr<NodeHooks> > m_hooks;
+};
+
+} // namespace ns3
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,359 @@
+#ifndef FAST_REROUTE_H
+#define FAST_REROUTE_H
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "neighbour-costs.h"
+
+namespace ns3 {
+
+/*
+ * Fast-reroute com loop-free alternates (RFC 5286) por roteador.
+ *
+ * A cada intervalo o roteador calcula, para cada sub-rede da topologia, o
+ * proximo salto primario (o do protocolo, ou o vizinho mais proximo) e os
+ * vizinhos por outras interfaces que satisfazem a condicao de LFA com custo
+ * 1 por enlace: dist(N, D) < dist(N, S) + dist(S, D). As distancias vem de
+ * NeighbourCosts (anuncios RIP ou topologia OLSR do no).
+ *
+ * Quando a interface primaria cai (Ipv4::SetDown), depois do tempo de
+ * deteccao os pacotes para aquela sub-rede saem pelo primeiro LFA ativo, ate
+ * o protocolo voltar a ter uma rota por interface ativa. Enquanto a
+ * primaria estiver fora a entrada nao e recalculada, para os alternativos
+ * continuarem os de antes da falha.
+ */
+class LfaRouting : public Ipv4RoutingProtocol
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::LfaRouting")
+      .SetParent<Ipv4RoutingProtocol> ()
+      .SetGroupName ("Internet")
+      .AddConstructor<LfaRouting> ();
+    return tid;
+  }
+
+  LfaRouting ()
+    : m_rerouted (0), m_firstReroute (Seconds (-1))
+  {
+  }
+
+  void Start (Time interval, Time detection)
+  {
+    m_interval = interval;
+    m_detection = detection;
+    Simulator::ScheduleNow (&LfaRouting::Precompute, this);
+  }
+
+  Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                              Socket::SocketErrno &sockerr)
+  {
+    if (oif)
+      {
+        return 0;
+      }
+    Ptr<Ipv4Route> route = Lookup (header.GetDestination ());
+    if (route)
+      {
+        sockerr = Socket::ERROR_NOTERROR;
+      }
+    return route;
+  }
+
+  bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                   UnicastForwardCallback ucb, MulticastForwardCallback mcb,
+                   LocalDeliverCallback lcb, ErrorCallback ecb)
+  {
+    if (!m_ipv4->IsForwarding (m_ipv4->GetInterfaceForDevice (idev)))
+      {
+        return false;
+      }
+    Ptr<Ipv4Route> route = Lookup (header.GetDestination ());
+    if (!route)
+      {
+        return false;
+      }
+    ucb (route, p, header);
+    return true;
+  }
+
+  void NotifyInterfaceUp (uint32_t interface)
+  {
+    m_downSince.erase (interface);
+  }
+
+  void NotifyInterfaceDown (uint32_t interface)
+  {
+    m_downSince[interface] = Simulator::Now ();
+  }
+
+  void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+  {
+  }
+
+  void SetIpv4 (Ptr<Ipv4> ipv4)
+  {
+    m_ipv4 = ipv4;
+    m_costs.SetIpv4 (ipv4);
+    m_protocol = Ipv4RoutingHelper::GetRouting<Rip> (ipv4->GetRoutingProtocol ());
+    if (!m_protocol)
+      {
+        m_protocol = Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+      }
+  }
+
+  void PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
+  {
+    std::ostream &os = *stream->GetStream ();
+    for (std::map<std::pair<uint32_t, uint32_t>, Entry>::const_iterator it = m_table.begin (); it != m_table.end (); ++it)
+      {
+        os << Ipv4Address (it->first.first) << "/" << Ipv4Mask (it->first.second).GetPrefixLength ()
+           << " primary " << it->second.primary.gateway << " if " << it->second.primary.interface;
+        for (std::vector<NeighbourCosts::Cost>::const_iterator a = it->second.alternates.begin ();
+             a != it->second.alternates.end (); ++a)
+          {
+            os << " lfa " << a->gateway << " if " << a->interface;
+          }
+        os << std::endl;
+      }
+  }
+
+  void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+  {
+    PrintRoutingTable (stream);
+  }
+
+  /* Sub-redes protegidas por pelo menos um LFA, total, pacotes desviados. */
+  uint32_t GetNProtected (void) const
+  {
+    uint32_t n = 0;
+    for (std::map<std::pair<uint32_t, uint32_t>, Entry>::const_iterator it = m_table.begin (); it != m_table.end (); ++it)
+      {
+        n += !it->second.alternates.empty ();
+      }
+    return n;
+  }
+
+  uint32_t GetNDestinations (void) const
+  {
+    return m_table.size ();
+  }
+
+  uint64_t GetRerouted (void) const
+  {
+    return m_rerouted;
+  }
+
+  Time GetFirstReroute (void) const
+  {
+    return m_firstReroute;
+  }
+
+private:
+  struct Entry
+  {
+    NeighbourCosts::Cost primary;
+    std::vector<NeighbourCosts::Cost> alternates;
+  };
+
+  static bool CloserFirst (const NeighbourCosts::Cost &a, const NeighbourCosts::Cost &b)
+  {
+    return a.distance < b.distance;
+  }
+
+  /* Rota atual do protocolo de baixo, se sair por uma interface ativa. */
+  Ptr<Ipv4Route> ProtocolRoute (Ipv4Address dest)
+  {
+    Ipv4Header header;
+    header.SetDestination (dest);
+    Socket::SocketErrno err;
+    Ptr<Ipv4Route> route = m_protocol->RouteOutput (Create<Packet> (), header, 0, err);
+    if (route && m_ipv4->IsUp (m_ipv4->GetInterfaceForDevice (route->GetOutputDevice ())))
+      {
+        return route;
+      }
+    return 0;
+  }
+
+  void Precompute (void)
+  {
+    if (m_subnets.empty ())
+      {
+        for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+          {
+            Ptr<Ipv4> ipv4 = NodeList::GetNode (n)->GetObject<Ipv4> ();
+            for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+              {
+                for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+                  {
+                    Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+                    m_subnets.insert (std::make_pair (addr.GetLocal ().CombineMask (addr.GetMask ()).Get (),
+                                                      addr.GetMask ().Get ()));
+                  }
+              }
+          }
+      }
+    for (std::set<std::pair<uint32_t, uint32_t> >::const_iterator s = m_subnets.begin (); s != m_subnets.end (); ++s)
+      {
+        Ipv4Address dest (s->first);
+        std::map<std::pair<uint32_t, uint32_t>, Entry>::iterator old = m_table.find (*s);
+        if (m_costs.IsConnected (dest)
+            || (old != m_table.end () && !m_ipv4->IsUp (old->second.primary.interface) && !ProtocolRoute (dest)))
+          {
+            continue;
+          }
+        std::vector<NeighbourCosts::Cost> costs = m_costs.Get (dest, Ipv4Mask (s->second));
+        if (costs.empty ())
+          {
+            m_table.erase (*s);
+            continue;
+          }
+        std::sort (costs.begin (), costs.end (), &LfaRouting::CloserFirst);
+        Entry entry;
+        entry.primary = costs.front ();
+        Ptr<Ipv4Route> route = ProtocolRoute (dest);
+        for (std::vector<NeighbourCosts::Cost>::const_iterator c = costs.begin (); route && c != costs.end (); ++c)
+          {
+            if (c->gateway == route->GetGateway ())
+              {
+                entry.primary = *c;
+              }
+          }
+        // dist(S, D) = primario + 1 e dist(N, S) = 1
+        for (std::vector<NeighbourCosts::Cost>::const_iterator c = costs.begin (); c != costs.end (); ++c)
+          {
+            if (c->interface != entry.primary.interface && c->distance < entry.primary.distance + 2)
+              {
+                entry.alternates.push_back (*c);
+              }
+          }
+        m_table[*s] = entry;
+      }
+    m_masks.clear ();
+    for (std::map<std::pair<uint32_t, uint32_t>, Entry>::const_iterator it = m_table.begin (); it != m_table.end (); ++it)
+      {
+        m_masks.insert (it->first.second);
+      }
+    Simulator::Schedule (m_interval, &LfaRouting::Precompute, this);
+  }
+
+  Ptr<Ipv4Route> Lookup (Ipv4Address dest)
+  {
+    // Sem interface fora nao ha o que desviar: o caminho comum sai aqui
+    if (m_downSince.empty () || dest.IsMulticast () || dest.IsBroadcast ())
+      {
+        return 0;
+      }
+    // Prefixo mais longo: uma busca por comprimento de mascara presente
+    const Entry *entry = 0;
+    for (std::set<uint32_t>::const_reverse_iterator mask = m_masks.rbegin (); !entry && mask != m_masks.rend (); ++mask)
+      {
+        std::map<std::pair<uint32_t, uint32_t>, Entry>::const_iterator it =
+          m_table.find (std::make_pair (dest.Get () & *mask, *mask));
+        if (it != m_table.end ())
+          {
+            entry = &it->second;
+          }
+      }
+    if (!entry || m_ipv4->IsUp (entry->primary.interface))
+      {
+        return 0;
+      }
+    std::map<uint32_t, Time>::const_iterator down = m_downSince.find (entry->primary.interface);
+    if (down == m_downSince.end () || Simulator::Now () - down->second < m_detection || ProtocolRoute (dest))
+      {
+        return 0;
+      }
+    for (std::vector<NeighbourCosts::Cost>::const_iterator a = entry->alternates.begin ();
+         a != entry->alternates.end (); ++a)
+      {
+        if (m_ipv4->IsUp (a->interface))
+          {
+            if (m_firstReroute.IsNegative ())
+              {
+                m_firstReroute = Simulator::Now ();
+              }
+            m_rerouted++;
+            Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+            route->SetDestination (dest);
+            route->SetGateway (a->gateway);
+            route->SetOutputDevice (m_ipv4->GetNetDevice (a->interface));
+            route->SetSource (m_ipv4->GetAddress (a->interface, 0).GetLocal ());
+            return route;
+          }
+      }
+    return 0;
+  }
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<Ipv4RoutingProtocol> m_protocol;
+  NeighbourCosts m_costs;
+  Time m_interval;
+  Time m_detection;
+  std::set<std::pair<uint32_t, uint32_t> > m_subnets;
+  std::map<std::pair<uint32_t, uint32_t>, Entry> m_table;
+  std::set<uint32_t> m_masks;
+  std::map<uint32_t, Time> m_downSince;
+  uint64_t m_rerouted;
+  Time m_firstReroute;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (LfaRouting);
+
+/*
+ * Instala o LfaRouting acima do protocolo (e do ECMP, se houver) em cada
+ * roteador e resume a protecao e o uso dos alternativos no fim.
+ */
+class FastReroute
+{
+public:
+  void Install (NodeContainer routers, Time interval, Time detection)
+  {
+    for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+      {
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> ((*it)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+        NS_ABORT_MSG_UNLESS (list, "Fast-reroute needs Ipv4ListRouting on " << Names::FindName (*it));
+        Ptr<LfaRouting> lfa = CreateObject<LfaRouting> ();
+        list->AddRoutingProtocol (lfa, 30);
+        lfa->Start (interval, detection);
+        m_nodes.push_back (*it);
+        m_lfas.push_back (lfa);
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Fast-reroute (loop-free alternates)" << std::endl;
+    for (uint32_t i = 0; i < m_lfas.size (); i++)
+      {
+        os << "  " << Names::FindName (m_nodes[i])
+           << " protected=" << m_lfas[i]->GetNProtected () << "/" << m_lfas[i]->GetNDestinations ()
+           << " rerouted=" << m_lfas[i]->GetRerouted ();
+        if (!m_lfas[i]->GetFirstReroute ().IsNegative ())
+          {
+            os << " first=" << m_lfas[i]->GetFirstReroute ().GetSeconds () << "s";
+          }
+        os << std::endl;
+      }
+  }
+
+private:
+  std::vector<Ptr<Node> > m_nodes;
+  std::vector<Ptr<LfaRouting> > m_lfas;
+};
+
+} // namespace ns3
+
+#endif /* FAST_REROUTE_H */
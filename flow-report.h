@@ -0,0 +1,47 @@
+#ifndef FLOW_REPORT_H
+#define FLOW_REPORT_H
+
+#include <map>
+#include <ostream>
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+
+namespace ns3 {
+
+/*
+ * Imprime, para cada fluxo UDP/TCP visto pelo FlowMonitor, pacotes
+ * transmitidos/recebidos/perdidos, atraso e jitter medios e vazao recebida.
+ * Usado para comparar o mesmo cenario com configuracoes diferentes (fila,
+ * roteamento, falha) olhando sempre o fluxo T->R. Classifier e o
+ * Ipv4FlowClassifier ou o Ipv6FlowClassifier do FlowMonitorHelper.
+ */
+template <class Classifier>
+void
+PrintFlowStats (Ptr<FlowMonitor> monitor, Ptr<Classifier> classifier, std::ostream &os)
+{
+  monitor->CheckForLostPackets ();
+  std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+  for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator it = stats.begin (); it != stats.end (); ++it)
+    {
+      typename Classifier::FiveTuple t = classifier->FindFlow (it->first);
+      const FlowMonitor::FlowStats &s = it->second;
+      double lossPct = s.txPackets ? 100.0 * s.lostPackets / s.txPackets : 0.0;
+      double delayMs = s.rxPackets ? s.delaySum.GetSeconds () * 1000 / s.rxPackets : 0.0;
+      double jitterMs = s.rxPackets > 1 ? s.jitterSum.GetSeconds () * 1000 / (s.rxPackets - 1) : 0.0;
+      double duration = (s.timeLastRxPacket - s.timeFirstTxPacket).GetSeconds ();
+      double kbps = duration > 0 ? s.rxBytes * 8.0 / duration / 1000 : 0.0;
+      os << "Flow " << it->first << " (" << t.sourceAddress << ":" << t.sourcePort
+         << " -> " << t.destinationAddress << ":" << t.destinationPort << ")"
+         << " tx=" << s.txPackets
+         << " rx=" << s.rxPackets
+         << " lost=" << s.lostPackets << " (" << lossPct << "%)"
+         << " delay=" << delayMs << "ms"
+         << " jitter=" << jitterMs << "ms"
+         << " throughput=" << kbps << "kbps" << std::endl;
+    }
+}
+
+} // namespace ns3
+
+#endif /* FLOW_REPORT_H */
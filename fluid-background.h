@@ -0,0 +1,231 @@
+#ifndef FLUID_BACKGROUND_H
+#define FLUID_BACKGROUND_H
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+namespace ns3 {
+
+/*
+ * Trafego de fundo modelado como fluido.
+ *
+ * Cada demanda (origem, destino, taxa) e roteada pelo caminho atual do
+ * RIP/OLSR, consultando RouteOutput salto a salto, e nenhum pacote e gerado.
+ * A carga agregada em cada device e aplicada aos pacotes de primeiro plano:
+ *
+ *  - a taxa do enlace passa a ser a capacidade residual (capacidade - fundo);
+ *  - o atraso do canal ganha a espera media M/M/1 do fundo,
+ *    rho / (1 - rho) * tempo de transmissao de um pacote medio.
+ *
+ * Os caminhos sao recalculados a cada intervalo, entao a carga acompanha a
+ * reconvergencia depois da falha. Em canais CSMA (meio compartilhado) a carga
+ * dos dois sentidos e somada; em PointToPoint a taxa e por sentido e o atraso
+ * do canal usa o maior dos dois.
+ *
+ * Formato das demandas: "Origem:Destino:Taxa[,Origem:Destino:Taxa...]",
+ * com nomes do Names (ex.: "TNode:RNode:2Mbps,RouterA:RouterD:1Mbps").
+ */
+class FluidBackground
+{
+public:
+  FluidBackground ()
+    : m_packetSize (1000)
+  {
+  }
+
+  void SetDemands (std::string demands)
+  {
+    std::istringstream in (demands);
+    std::string item;
+    while (std::getline (in, item, ','))
+      {
+        std::string::size_type p1 = item.find (':');
+        std::string::size_type p2 = item.find (':', p1 + 1);
+        NS_ABORT_MSG_IF (p1 == std::string::npos || p2 == std::string::npos,
+                         "Bad fluid demand " << item << " (expected Src:Dst:Rate)");
+        Demand d;
+        d.src = Names::Find<Node> (item.substr (0, p1));
+        Ptr<Node> dst = Names::Find<Node> (item.substr (p1 + 1, p2 - p1 - 1));
+        NS_ABORT_MSG_IF (!d.src || !dst, "Unknown node in fluid demand " << item);
+        d.dst = dst->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ();
+        d.rate = DataRate (item.substr (p2 + 1));
+        m_demands.push_back (d);
+      }
+  }
+
+  /* Tamanho medio (bytes) dos pacotes de fundo, usado no atraso de fila. */
+  void SetPacketSize (uint32_t bytes)
+  {
+    m_packetSize = bytes;
+  }
+
+  void Start (Time interval)
+  {
+    m_interval = interval;
+    // Capacidades e atrasos originais, antes de qualquer ajuste
+    for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+      {
+        Ptr<Node> node = NodeList::GetNode (n);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+        for (uint32_t i = 0; ipv4 && i < ipv4->GetNInterfaces (); i++)
+          {
+            for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+              {
+                m_owner[ipv4->GetAddress (i, j).GetLocal ()] = node;
+              }
+          }
+        for (uint32_t i = 0; i < node->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = node->GetDevice (i);
+            Ptr<Channel> channel = dev->GetChannel ();
+            if (DynamicCast<PointToPointNetDevice> (dev))
+              {
+                DataRateValue rate;
+                dev->GetAttribute ("DataRate", rate);
+                m_baseRate[PeekPointer (dev)] = rate.Get ();
+              }
+            else if (DynamicCast<CsmaNetDevice> (dev))
+              {
+                m_baseRate[PeekPointer (channel)] = DynamicCast<CsmaChannel> (channel)->GetDataRate ();
+              }
+            else
+              {
+                continue;
+              }
+            TimeValue delay;
+            channel->GetAttribute ("Delay", delay);
+            m_baseDelay[channel] = delay.Get ();
+          }
+      }
+    Simulator::ScheduleNow (&FluidBackground::Update, this);
+  }
+
+  /* Carga de fundo atual por device (bps). */
+  void Print (std::ostream &os) const
+  {
+    os << "Fluid background load" << std::endl;
+    for (std::map<Ptr<NetDevice>, double>::const_iterator it = m_load.begin (); it != m_load.end (); ++it)
+      {
+        os << "  " << Names::FindName (it->first->GetNode ()) << "/" << it->first->GetIfIndex ()
+           << " " << it->second / 1e6 << "Mbps" << std::endl;
+      }
+  }
+
+private:
+  struct Demand
+  {
+    Ptr<Node> src;
+    Ipv4Address dst;
+    DataRate rate;
+  };
+
+  void Update (void)
+  {
+    m_load.clear ();
+    for (std::vector<Demand>::const_iterator d = m_demands.begin (); d != m_demands.end (); ++d)
+      {
+        Route (*d);
+      }
+
+    // Carga por recurso: device (PointToPoint) ou canal (CSMA)
+    std::map<ObjectBase *, double> shared;
+    for (std::map<Ptr<NetDevice>, double>::const_iterator it = m_load.begin (); it != m_load.end (); ++it)
+      {
+        if (DynamicCast<CsmaNetDevice> (it->first))
+          {
+            shared[PeekPointer (it->first->GetChannel ())] += it->second;
+          }
+        else
+          {
+            shared[PeekPointer (it->first)] += it->second;
+          }
+      }
+
+    std::map<Ptr<Channel>, Time> extraDelay;
+    for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+      {
+        Ptr<Node> node = NodeList::GetNode (n);
+        for (uint32_t i = 0; i < node->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = node->GetDevice (i);
+            Ptr<Channel> channel = dev->GetChannel ();
+            Ptr<CsmaChannel> csmaChannel = DynamicCast<CsmaChannel> (channel);
+            ObjectBase *resource = PeekPointer (dev);
+            if (csmaChannel)
+              {
+                resource = PeekPointer (channel);
+              }
+            if (m_baseRate.find (resource) == m_baseRate.end ())
+              {
+                continue;
+              }
+            double capacity = m_baseRate[resource].GetBitRate ();
+            double rho = std::min (shared[resource] / capacity, 0.99);
+            DataRateValue residual (DataRate (static_cast<uint64_t> (capacity * (1 - rho))));
+            if (csmaChannel)
+              {
+                csmaChannel->SetAttribute ("DataRate", residual);
+              }
+            else
+              {
+                dev->SetAttribute ("DataRate", residual);
+              }
+            Time wait = Seconds (rho / (1 - rho) * m_packetSize * 8 / capacity);
+            extraDelay[channel] = std::max (extraDelay[channel], wait);
+          }
+      }
+    for (std::map<Ptr<Channel>, Time>::const_iterator it = m_baseDelay.begin (); it != m_baseDelay.end (); ++it)
+      {
+        it->first->SetAttribute ("Delay", TimeValue (it->second + extraDelay[it->first]));
+      }
+
+    Simulator::Schedule (m_interval, &FluidBackground::Update, this);
+  }
+
+  /* Segue RouteOutput salto a salto somando a taxa em cada device de saida. */
+  void Route (const Demand &d)
+  {
+    Ptr<Node> node = d.src;
+    for (uint32_t hops = 0; node && node != m_owner[d.dst] && hops < 32; hops++)
+      {
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+        Ipv4Header header;
+        header.SetDestination (d.dst);
+        Socket::SocketErrno err;
+        Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol ()->RouteOutput (Create<Packet> (), header, 0, err);
+        if (!route)
+          {
+            // Sem rota: a demanda e perdida neste intervalo
+            return;
+          }
+        m_load[route->GetOutputDevice ()] += d.rate.GetBitRate ();
+        if (route->GetGateway () == Ipv4Address::GetAny ())
+          {
+            return;
+          }
+        node = m_owner[route->GetGateway ()];
+      }
+  }
+
+  std::vector<Demand> m_demands;
+  std::map<Ipv4Address, Ptr<Node> > m_owner;
+  std::map<ObjectBase *, DataRate> m_baseRate;
+  std::map<Ptr<Channel>, Time> m_baseDelay;
+  std::map<Ptr<NetDevice>, double> m_load;
+  uint32_t m_packetSize;
+  Time m_interval;
+};
+
+} // namespace ns3
+
+#endif /* FLUID_BACKGROUND_H */
@@ -0,0 +1,387 @@
+#ifndef FORWARDING_MONITOR_H
+#define FORWARDING_MONITOR_H
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/*
+ * Loops e blackholes no plano de encaminhamento (IPv4), para todos os
+ * pacotes encaminhados: cada pacote e seguido pelo uid (o mesmo em todos os
+ * saltos) nos traces UnicastForward, LocalDeliver e Drop dos nos.
+ *
+ *   loop       o pacote voltou a um roteador que ja o tinha encaminhado;
+ *              desperdicio = bytes x encaminhamentos alem do caminho sem
+ *              ciclos se foi entregue, ou x todos os saltos se morreu (TTL)
+ *   blackhole  descartado sem rota ou em interface desligada; desperdicio =
+ *              bytes x saltos ate o descarte
+ *
+ * As deteccoes sao agregadas por prefixo de destino (a sub-rede de
+ * interface mais especifica da topologia que contem o endereco), por
+ * evento de falha (o ultimo registrado com AddEvent antes da deteccao) e
+ * por janela de tempo. Duracao do loop = primeira ate ultima deteccao no
+ * mesmo prefixo e evento.
+ *
+ * Pacotes sem fim observado (fila cheia, enlace cortado) sao fechados
+ * depois de 5 s. Cada pacote encaminhado custa uma busca num mapa.
+ */
+class ForwardingMonitor
+{
+public:
+  ForwardingMonitor ()
+    : m_window (Seconds (1))
+  {
+  }
+
+  void Install (NodeContainer nodes, Time window)
+  {
+    m_window = window;
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        if (!ipv4)
+          {
+            continue;
+          }
+        for (uint32_t i = 1; i < ipv4->GetNInterfaces (); i++)
+          {
+            for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+              {
+                Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+                m_prefixes.insert (std::make_pair (addr.GetMask ().GetPrefixLength (),
+                                                   addr.GetLocal ().CombineMask (addr.GetMask ()).Get ()));
+              }
+          }
+        uint32_t id = (*n)->GetId ();
+        ipv4->TraceConnectWithoutContext ("UnicastForward", MakeBoundCallback (&ForwardingMonitor::Forward, this, id));
+        ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeBoundCallback (&ForwardingMonitor::Deliver, this, id));
+        ipv4->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&ForwardingMonitor::Dropped, this, id));
+      }
+    Simulator::Schedule (Seconds (5), &ForwardingMonitor::Expire, this);
+  }
+
+  void AddEvent (Time at, std::string name)
+  {
+    m_events.push_back (std::make_pair (at, name));
+  }
+
+  void Print (std::ostream &os, std::string strategy)
+  {
+    Flush ();
+    os << "Forwarding loops and blackholes (" << strategy << "), window " << m_window.GetSeconds () << "s"
+       << std::endl;
+    int32_t event = -2;
+    for (std::map<std::pair<int32_t, std::string>, Stats>::const_iterator it = m_stats.begin (); it != m_stats.end ();
+         ++it)
+      {
+        if (it->first.first != event)
+          {
+            event = it->first.first;
+            if (event < 0)
+              {
+                os << "  before any failure" << std::endl;
+              }
+            else
+              {
+                os << "  " << m_events[event].second << " at " << m_events[event].first.GetSeconds () << "s"
+                   << std::endl;
+              }
+          }
+        const Stats &s = it->second;
+        os << "    " << it->first.second << " loops=" << s.loops << " ttlExpired=" << s.ttlExpired
+           << " loopWasted=" << s.loopBytes << "B";
+        if (s.loops)
+          {
+            os << " loopDuration=" << (s.lastLoop - s.firstLoop).GetSeconds () << "s ("
+               << s.firstLoop.GetSeconds () << "-" << s.lastLoop.GetSeconds () << "s)";
+          }
+        os << " blackholes=" << s.blackholes << " blackholeWasted=" << s.blackholeBytes << "B";
+        if (s.blackholes)
+          {
+            os << " (" << s.firstBlackhole.GetSeconds () << "-" << s.lastBlackhole.GetSeconds () << "s)";
+          }
+        os << std::endl;
+        for (std::map<int64_t, std::pair<uint32_t, uint32_t> >::const_iterator w = s.windows.begin ();
+             w != s.windows.end (); ++w)
+          {
+            os << "      " << w->first * m_window.GetSeconds () << "s loops=" << w->second.first
+               << " blackholes=" << w->second.second << std::endl;
+          }
+      }
+    Stats total = Total ();
+    os << "  total loops=" << total.loops << " loopWasted=" << total.loopBytes << "B blackholes=" << total.blackholes
+       << " blackholeWasted=" << total.blackholeBytes << "B" << std::endl;
+  }
+
+  /* Totais para o registro de resultado (result-record.h). */
+  std::string ToJson (void)
+  {
+    Flush ();
+    Stats total = Total ();
+    std::ostringstream os;
+    os << "{\"loops\": " << total.loops << ", \"ttl_expired\": " << total.ttlExpired
+       << ", \"loop_wasted_bytes\": " << total.loopBytes
+       << ", \"loop_s\": " << (total.loops ? (total.lastLoop - total.firstLoop).GetSeconds () : 0.0)
+       << ", \"blackholes\": " << total.blackholes << ", \"blackhole_wasted_bytes\": " << total.blackholeBytes
+       << ", \"blackhole_s\": "
+       << (total.blackholes ? (total.lastBlackhole - total.firstBlackhole).GetSeconds () : 0.0) << "}";
+    return os.str ();
+  }
+
+private:
+  /* Fecha como perdidos os pacotes ainda em transito. */
+  void Flush (void)
+  {
+    while (!m_flights.empty ())
+      {
+        Finish (m_flights.begin (), LOST);
+      }
+  }
+
+  enum Outcome
+  {
+    DELIVERED,
+    TTL_EXPIRED,
+    BLACKHOLE,
+    LOST
+  };
+
+  struct Flight
+  {
+    Ipv4Address dst;
+    uint32_t size;
+    Time start;
+    bool looped;
+    Time loopAt;
+    std::vector<uint32_t> forwarders;
+  };
+
+  struct Stats
+  {
+    Stats ()
+      : loops (0), ttlExpired (0), loopBytes (0), blackholes (0), blackholeBytes (0)
+    {
+    }
+
+    void Loop (Time t)
+    {
+      firstLoop = loops ? std::min (firstLoop, t) : t;
+      lastLoop = loops ? std::max (lastLoop, t) : t;
+      loops++;
+    }
+
+    void Blackhole (Time t)
+    {
+      firstBlackhole = blackholes ? std::min (firstBlackhole, t) : t;
+      lastBlackhole = blackholes ? std::max (lastBlackhole, t) : t;
+      blackholes++;
+    }
+
+    uint64_t loops;
+    uint64_t ttlExpired;
+    uint64_t loopBytes;
+    uint64_t blackholes;
+    uint64_t blackholeBytes;
+    Time firstLoop;
+    Time lastLoop;
+    Time firstBlackhole;
+    Time lastBlackhole;
+    std::map<int64_t, std::pair<uint32_t, uint32_t> > windows;
+  };
+
+  typedef std::map<uint64_t, Flight> FlightMap;
+
+  int32_t EventAt (Time t) const
+  {
+    int32_t event = -1;
+    for (uint32_t k = 0; k < m_events.size (); k++)
+      {
+        if (m_events[k].first <= t && (event < 0 || m_events[k].first >= m_events[event].first))
+          {
+            event = k;
+          }
+      }
+    return event;
+  }
+
+  std::string Prefix (Ipv4Address dst) const
+  {
+    uint32_t length = 32;
+    uint32_t network = dst.Get ();
+    for (std::set<std::pair<uint32_t, uint32_t> >::const_reverse_iterator p = m_prefixes.rbegin ();
+         p != m_prefixes.rend (); ++p)
+      {
+        Ipv4Mask mask (p->first ? ~0u << (32 - p->first) : 0u);
+        if (dst.CombineMask (mask).Get () == p->second)
+          {
+            length = p->first;
+            network = p->second;
+            break;
+          }
+      }
+    std::ostringstream os;
+    os << Ipv4Address (network) << "/" << length;
+    return os.str ();
+  }
+
+  Stats &StatsFor (const Flight &f, Time t)
+  {
+    return m_stats[std::make_pair (EventAt (t), Prefix (f.dst))];
+  }
+
+  FlightMap::iterator Track (const Ipv4Header &header, Ptr<const Packet> packet)
+  {
+    FlightMap::iterator it = m_flights.find (packet->GetUid ());
+    if (it == m_flights.end ())
+      {
+        Flight f;
+        f.dst = header.GetDestination ();
+        f.size = packet->GetSize () + header.GetSerializedSize ();
+        f.start = Simulator::Now ();
+        f.looped = false;
+        it = m_flights.insert (std::make_pair (packet->GetUid (), f)).first;
+      }
+    return it;
+  }
+
+  static void Forward (ForwardingMonitor *self, uint32_t node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       uint32_t interface)
+  {
+    FlightMap::iterator it = self->Track (header, packet);
+    Flight &f = it->second;
+    if (!f.looped && std::find (f.forwarders.begin (), f.forwarders.end (), node) != f.forwarders.end ())
+      {
+        f.looped = true;
+        Time now = Simulator::Now ();
+        f.loopAt = now;
+        Stats &s = self->StatsFor (f, now);
+        s.Loop (now);
+        s.windows[now.GetInteger () / self->m_window.GetInteger ()].first++;
+      }
+    f.forwarders.push_back (node);
+  }
+
+  static void Deliver (ForwardingMonitor *self, uint32_t node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       uint32_t interface)
+  {
+    FlightMap::iterator it = self->m_flights.find (packet->GetUid ());
+    if (it != self->m_flights.end ())
+      {
+        self->Finish (it, DELIVERED);
+      }
+  }
+
+  static void Dropped (ForwardingMonitor *self, uint32_t node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    if (reason == Ipv4L3Protocol::DROP_TTL_EXPIRED)
+      {
+        self->Finish (self->Track (header, packet), TTL_EXPIRED);
+      }
+    else if (reason == Ipv4L3Protocol::DROP_NO_ROUTE || reason == Ipv4L3Protocol::DROP_INTERFACE_DOWN)
+      {
+        if (header.GetDestination ().IsMulticast () || header.GetDestination ().IsBroadcast ())
+          {
+            return;
+          }
+        FlightMap::iterator it = self->Track (header, packet);
+        Time now = Simulator::Now ();
+        Stats &s = self->StatsFor (it->second, now);
+        s.Blackhole (now);
+        s.windows[now.GetInteger () / self->m_window.GetInteger ()].second++;
+        self->Finish (it, BLACKHOLE);
+      }
+  }
+
+  void Finish (FlightMap::iterator it, Outcome outcome)
+  {
+    const Flight &f = it->second;
+    uint64_t hops = f.forwarders.size ();
+    if (outcome == BLACKHOLE)
+      {
+        StatsFor (f, Simulator::Now ()).blackholeBytes += f.size * (hops + 1);
+      }
+    else if (f.looped || outcome == TTL_EXPIRED)
+      {
+        // Tudo do loop fica no evento da deteccao, como a contagem de loops;
+        // sem deteccao (TTL esgotado sem repetir roteador), no da expiracao
+        Stats &s = StatsFor (f, f.looped ? f.loopAt : Simulator::Now ());
+        if (outcome == TTL_EXPIRED)
+          {
+            s.ttlExpired++;
+          }
+        if (outcome == DELIVERED)
+          {
+            std::set<uint32_t> distinct (f.forwarders.begin (), f.forwarders.end ());
+            s.loopBytes += f.size * (hops - distinct.size ());
+          }
+        else
+          {
+            s.loopBytes += f.size * (hops + 1);
+          }
+      }
+    m_flights.erase (it);
+  }
+
+  void Expire (void)
+  {
+    Time limit = Simulator::Now () - Seconds (5);
+    for (FlightMap::iterator it = m_flights.begin (); it != m_flights.end ();)
+      {
+        FlightMap::iterator next = it;
+        ++next;
+        if (it->second.start < limit)
+          {
+            Finish (it, LOST);
+          }
+        it = next;
+      }
+    Simulator::Schedule (Seconds (5), &ForwardingMonitor::Expire, this);
+  }
+
+  Stats Total (void) const
+  {
+    Stats total;
+    for (std::map<std::pair<int32_t, std::string>, Stats>::const_iterator it = m_stats.begin (); it != m_stats.end ();
+         ++it)
+      {
+        const Stats &s = it->second;
+        if (s.loops)
+          {
+            total.firstLoop = total.loops ? std::min (total.firstLoop, s.firstLoop) : s.firstLoop;
+            total.lastLoop = total.loops ? std::max (total.lastLoop, s.lastLoop) : s.lastLoop;
+          }
+        if (s.blackholes)
+          {
+            total.firstBlackhole = total.blackholes ? std::min (total.firstBlackhole, s.firstBlackhole) : s.firstBlackhole;
+            total.lastBlackhole = total.blackholes ? std::max (total.lastBlackhole, s.lastBlackhole) : s.lastBlackhole;
+          }
+        total.loops += s.loops;
+        total.ttlExpired += s.ttlExpired;
+        total.loopBytes += s.loopBytes;
+        total.blackholes += s.blackholes;
+        total.blackholeBytes += s.blackholeBytes;
+      }
+    return total;
+  }
+
+  Time m_window;
+  std::set<std::pair<uint32_t, uint32_t> > m_prefixes;
+  std::vector<std::pair<Time, std::string> > m_events;
+  FlightMap m_flights;
+  std::map<std::pair<int32_t, std::string>, Stats> m_stats;
+};
+
+} // namespace ns3
+
+#endif /* FORWARDING_MONITOR_H */
@@ -0,0 +1,39 @@
+#ifndef IPV6_ADDRESSING_H
+#define IPV6_ADDRESSING_H
+
+#include <sstream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ripng.h"
+
+namespace ns3 {
+
+/*
+ * Variante IPv6 dos cenarios RIP: a sub-rede n do cenario IPv4 (10.0.n.0/24)
+ * vira 2001:0:n::/64. O forwarding so e ligado nas interfaces dos nos que
+ * rodam RIPng; os hosts ficam so com a rota default estatica.
+ */
+inline Ipv6InterfaceContainer
+AssignIpv6Subnet (NetDeviceContainer devices, uint32_t subnet)
+{
+  std::ostringstream base;
+  base << "2001:0:" << std::hex << subnet << "::";
+  Ipv6AddressHelper ipv6;
+  ipv6.SetBase (Ipv6Address (base.str ().c_str ()), Ipv6Prefix (64));
+  Ipv6InterfaceContainer iic = ipv6.Assign (devices);
+  for (uint32_t i = 0; i < iic.GetN (); i++)
+    {
+      Ptr<Ipv6> node = iic.Get (i).first;
+      if (Ipv6RoutingHelper::GetRouting<RipNg> (node->GetRoutingProtocol ()))
+        {
+          iic.SetForwarding (i, true);
+        }
+    }
+  return iic;
+}
+
+} // namespace ns3
+
+#endif /* IPV6_ADDRESSING_H */
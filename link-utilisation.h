@@ -0,0 +1,102 @@
+#ifndef LINK_UTILISATION_H
+#define LINK_UTILISATION_H
+
+#include <ostream>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+namespace ns3 {
+
+/*
+ * Utilizacao por enlace: bytes que cada device CSMA/PointToPoint terminou de
+ * transmitir (PhyTxEnd, com cabecalhos de enlace) divididos pela capacidade
+ * do enlace no periodo medido. Mostra como a carga se divide entre os
+ * caminhos, por exemplo com ECMP ou com a matriz de trafego.
+ */
+class LinkUtilisation
+{
+public:
+  void Install (NodeContainer nodes)
+  {
+    m_start = Simulator::Now ();
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = (*n)->GetDevice (i);
+            Ptr<Counter> counter = Create<Counter> ();
+            DataRateValue rate;
+            if (DynamicCast<CsmaNetDevice> (dev))
+              {
+                dev->GetChannel ()->GetAttribute ("DataRate", rate);
+              }
+            else if (DynamicCast<PointToPointNetDevice> (dev))
+              {
+                dev->GetAttribute ("DataRate", rate);
+              }
+            else
+              {
+                continue;
+              }
+            counter->device = dev;
+            counter->rate = rate.Get ();
+            dev->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&Counter::TxEnd, counter));
+            m_counters.push_back (counter);
+          }
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    double elapsed = (Simulator::Now () - m_start).GetSeconds ();
+    os << "Link utilisation over " << elapsed << "s" << std::endl;
+    for (std::vector<Ptr<Counter> >::const_iterator it = m_counters.begin (); it != m_counters.end (); ++it)
+      {
+        Ptr<Counter> c = *it;
+        os << "  " << Names::FindName (c->device->GetNode ()) << "/" << c->device->GetIfIndex () << " ->";
+        Ptr<Channel> channel = c->device->GetChannel ();
+        for (uint32_t k = 0; k < channel->GetNDevices (); k++)
+          {
+            if (channel->GetDevice (k) != c->device)
+              {
+                os << " " << Names::FindName (channel->GetDevice (k)->GetNode ());
+              }
+          }
+        double util = elapsed > 0 ? 100.0 * c->bytes * 8 / (c->rate.GetBitRate () * elapsed) : 0.0;
+        os << " packets=" << c->packets << " bytes=" << c->bytes
+           << " load=" << (elapsed > 0 ? c->bytes * 8 / elapsed / 1e6 : 0.0) << "Mbps utilisation=" << util << "%"
+           << std::endl;
+      }
+  }
+
+private:
+  struct Counter : public SimpleRefCount<Counter>
+  {
+    Counter ()
+      : packets (0), bytes (0)
+    {
+    }
+
+    void TxEnd (Ptr<const Packet> packet)
+    {
+      packets++;
+      bytes += packet->GetSize ();
+    }
+
+    Ptr<NetDevice> device;
+    DataRate rate;
+    uint64_t packets;
+    uint64_t bytes;
+  };
+
+  std::vector<Ptr<Counter> > m_counters;
+  Time m_start;
+};
+
+} // namespace ns3
+
+#endif /* LINK_UTILISATION_H */
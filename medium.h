@@ -0,0 +1,251 @@
+#ifndef MEDIUM_H
+#define MEDIUM_H
+
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/constant-position-mobility-model.h"
+
+namespace ns3 {
+
+/*
+ * Monta os enlaces de um cenario em CSMA ou PointToPoint com a mesma taxa e
+ * o mesmo atraso, para comparar RIP e OLSR no mesmo meio. No CSMA a taxa e
+ * a do canal, dividida entre todos os devices do segmento (half-duplex); no
+ * PointToPoint e a de cada sentido. Tem a mesma interface Install dos
+ * helpers do ns-3, entao tambem serve ao BuildRouterGrid.
+ */
+class MediumHelper
+{
+public:
+  MediumHelper (std::string medium)
+    : m_medium (medium)
+  {
+    NS_ABORT_MSG_UNLESS (medium == "csma" || medium == "p2p", "Unknown medium " << medium);
+  }
+
+  bool IsCsma (void) const
+  {
+    return m_medium == "csma";
+  }
+
+  /* Taxa e atraso dos proximos enlaces instalados. */
+  void SetLink (DataRate rate, Time delay)
+  {
+    m_csma.SetChannelAttribute ("DataRate", DataRateValue (rate));
+    m_csma.SetChannelAttribute ("Delay", TimeValue (delay));
+    m_p2p.SetDeviceAttribute ("DataRate", DataRateValue (rate));
+    m_p2p.SetChannelAttribute ("Delay", TimeValue (delay));
+  }
+
+  NetDeviceContainer Install (NodeContainer nodes)
+  {
+    if (IsCsma ())
+      {
+        return m_csma.Install (nodes);
+      }
+    NS_ABORT_MSG_UNLESS (nodes.GetN () == 2, "A PointToPoint link joins exactly two nodes");
+    return m_p2p.Install (nodes);
+  }
+
+  /* So os devices CSMA sorteiam (backoff). */
+  int64_t AssignStreams (NetDeviceContainer devices, int64_t stream)
+  {
+    return m_csma.AssignStreams (devices, stream);
+  }
+
+  void EnableAsciiAll (Ptr<OutputStreamWrapper> stream)
+  {
+    m_csma.EnableAsciiAll (stream);
+    m_p2p.EnableAsciiAll (stream);
+  }
+
+  void EnablePcapAll (std::string prefix, bool promiscuous)
+  {
+    m_csma.EnablePcapAll (prefix, promiscuous);
+    m_p2p.EnablePcapAll (prefix, promiscuous);
+  }
+
+private:
+  std::string m_medium;
+  CsmaHelper m_csma;
+  PointToPointHelper m_p2p;
+};
+
+/*
+ * Segmento com n hosts pendurado num roteador, so IPv4. No CSMA os hosts e
+ * o roteador dividem um unico canal (10.1.0.0/24); no PointToPoint cada
+ * host ganha um enlace dedicado (10.1.i.0/24). Os hosts usam rota default
+ * estatica pelo roteador.
+ *
+ * Como o BuildRouterGrid, deve ser chamado depois do enderecamento original
+ * para nao mudar os indices de interface do cenario.
+ */
+inline NodeContainer
+AttachHostSegment (uint32_t n, Ptr<Node> router, MediumHelper &links, InternetStackHelper &stack)
+{
+  NodeContainer hosts;
+  if (n == 0)
+    {
+      return hosts;
+    }
+  hosts.Create (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      std::ostringstream name;
+      name << "SegmentHost" << i;
+      Names::Add (name.str (), hosts.Get (i));
+    }
+  stack.Install (hosts);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (hosts);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase (Ipv4Address ("10.1.0.0"), Ipv4Mask ("255.255.255.0"));
+  std::vector<Ipv4Address> gateways;
+  if (links.IsCsma ())
+    {
+      Ipv4InterfaceContainer iic = ipv4.Assign (links.Install (NodeContainer (NodeContainer (router), hosts)));
+      gateways.assign (n, iic.GetAddress (0));
+    }
+  else
+    {
+      for (uint32_t i = 0; i < n; i++)
+        {
+          gateways.push_back (ipv4.Assign (links.Install (NodeContainer (router, hosts.Get (i)))).GetAddress (0));
+          ipv4.NewNetwork ();
+        }
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      hosts.Get (i)->GetObject<ConstantPositionMobilityModel> ()->SetPosition (Vector (10.0 + i * 5, 80.0, 0));
+      Ptr<Ipv4StaticRouting> routing =
+        Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting> (hosts.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      routing->SetDefaultRoute (gateways[i], 1);
+    }
+  return hosts;
+}
+
+/*
+ * Disputa e utilizacao por canal (segmento CSMA ou enlace PointToPoint).
+ *
+ * O CSMA do ns-3 nao modela colisoes: o carrier sense enxerga o canal
+ * ocupado na hora, entao a disputa aparece como backoffs (MacTxBackoff) e
+ * como pacotes abandonados depois do limite de tentativas (PhyTxDrop). A
+ * utilizacao efetiva e o tempo de transmissao somado de todos os devices
+ * sobre a capacidade do canal: a taxa do canal no CSMA e duas vezes a taxa
+ * no PointToPoint, que e full-duplex.
+ */
+class MediumStats
+{
+public:
+  void Install (NodeContainer nodes)
+  {
+    m_start = Simulator::Now ();
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = (*n)->GetDevice (i);
+            bool csma = DynamicCast<CsmaNetDevice> (dev);
+            if (!csma && !DynamicCast<PointToPointNetDevice> (dev))
+              {
+                continue;
+              }
+            Ptr<Segment> &s = m_segments[dev->GetChannel ()->GetId ()];
+            if (!s)
+              {
+                s = Create<Segment> ();
+                s->channel = dev->GetChannel ();
+                s->csma = csma;
+                DataRateValue rate;
+                if (csma)
+                  {
+                    s->channel->GetAttribute ("DataRate", rate);
+                  }
+                else
+                  {
+                    dev->GetAttribute ("DataRate", rate);
+                  }
+                s->rate = rate.Get ();
+              }
+            dev->TraceConnectWithoutContext ("PhyTxEnd", MakeCallback (&Segment::TxEnd, s));
+            dev->TraceConnectWithoutContext ("PhyTxDrop", MakeCallback (&Segment::TxDrop, s));
+            if (csma)
+              {
+                dev->TraceConnectWithoutContext ("MacTxBackoff", MakeCallback (&Segment::Backoff, s));
+              }
+          }
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    double elapsed = (Simulator::Now () - m_start).GetSeconds ();
+    os << "Medium contention over " << elapsed << "s" << std::endl;
+    for (std::map<uint32_t, Ptr<Segment> >::const_iterator it = m_segments.begin (); it != m_segments.end (); ++it)
+      {
+        Ptr<Segment> s = it->second;
+        os << "  " << (s->csma ? "csma" : "p2p") << " " << s->rate.GetBitRate () / 1e6 << "Mbps";
+        for (uint32_t k = 0; k < s->channel->GetNDevices (); k++)
+          {
+            os << (k ? "," : " ") << Names::FindName (s->channel->GetDevice (k)->GetNode ());
+          }
+        double capacity = s->rate.GetBitRate () * elapsed * (s->csma ? 1 : 2);
+        os << " packets=" << s->packets << " bytes=" << s->bytes << " backoffs=" << s->backoffs
+           << " txDrops=" << s->drops
+           << " utilisation=" << (capacity > 0 ? 100.0 * s->bytes * 8 / capacity : 0.0) << "%" << std::endl;
+      }
+  }
+
+private:
+  struct Segment : public SimpleRefCount<Segment>
+  {
+    Segment ()
+      : csma (false), packets (0), bytes (0), backoffs (0), drops (0)
+    {
+    }
+
+    void TxEnd (Ptr<const Packet> packet)
+    {
+      packets++;
+      bytes += packet->GetSize ();
+    }
+
+    void TxDrop (Ptr<const Packet> packet)
+    {
+      drops++;
+    }
+
+    void Backoff (Ptr<const Packet> packet)
+    {
+      backoffs++;
+    }
+
+    Ptr<Channel> channel;
+    bool csma;
+    DataRate rate;
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t backoffs;
+    uint64_t drops;
+  };
+
+  std::map<uint32_t, Ptr<Segment> > m_segments;
+  Time m_start;
+};
+
+} // namespace ns3
+
+#endif /* MEDIUM_H */
@@ -0,0 +1,357 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/olsr-routing-protocol.h"
+
+namespace ns3 {
+
+/*
+ * Registro de metricas em serie temporal com memoria fixa.
+ *
+ * Qualquer modulo registra contadores (incrementados com Increment ou lidos
+ * de um callback cumulativo) e gauges (lidos de um callback). A cada
+ * intervalo de amostragem o valor de cada metrica vai para um anel de
+ * window posicoes; a cada writeEvery amostras uma linha por metrica e
+ * escrita com o agregado da janela:
+ *
+ *   contador: valor atual e taxa (por segundo) na janela
+ *   gauge:    valor atual, minimo, maximo e media na janela
+ *
+ * em CSV (time,metric,labels,value,rate,min,max,mean; labels separados por
+ * ';') ou em line protocol do InfluxDB (metric,labels value=..,... tempo em
+ * ns), com flush a cada escrita para um dashboard acompanhar o arquivo
+ * durante a execucao. Os valores saem com %.17g (o double inteiro, contadores
+ * grandes sem arredondar) e o tempo do CSV com 9 casas (resolucao de ns).
+ * A memoria e window doubles por metrica, qualquer que seja a duracao da
+ * simulacao.
+ */
+class MetricsRegistry
+{
+public:
+  static MetricsRegistry *Get (void)
+  {
+    static MetricsRegistry registry;
+    return &registry;
+  }
+
+  /* Contador mantido pelo modulo; devolve o id usado em Increment. */
+  uint32_t AddCounter (std::string name, std::string labels)
+  {
+    return Add (name, labels, true, MakeNullCallback<double> ());
+  }
+
+  /* Contador cumulativo lido a cada amostra. */
+  uint32_t AddCounter (std::string name, std::string labels, Callback<double> read)
+  {
+    return Add (name, labels, true, read);
+  }
+
+  uint32_t AddGauge (std::string name, std::string labels, Callback<double> read)
+  {
+    return Add (name, labels, false, read);
+  }
+
+  void Increment (uint32_t id, double amount = 1.0)
+  {
+    m_metrics[id].total += amount;
+  }
+
+  void Start (std::string fileName, bool lineProtocol, Time interval, uint32_t window, uint32_t writeEvery)
+  {
+    m_file = std::fopen (fileName.c_str (), "w");
+    NS_ABORT_MSG_UNLESS (m_file, "Cannot open metrics file " << fileName);
+    NS_ABORT_MSG_UNLESS (window >= 2, "The metrics window needs at least two samples");
+    m_lineProtocol = lineProtocol;
+    m_interval = interval;
+    m_window = window;
+    m_writeEvery = std::max (writeEvery, 1u);
+    if (!m_lineProtocol)
+      {
+        std::fprintf (m_file, "time,metric,labels,value,rate,min,max,mean\n");
+      }
+    AddCounter ("sim_events", "", MakeCallback (&MetricsRegistry::EventCount));
+    for (std::vector<Metric>::iterator m = m_metrics.begin (); m != m_metrics.end (); ++m)
+      {
+        m->ring.assign (m_window, 0.0);
+      }
+    Simulator::Schedule (m_interval, &MetricsRegistry::Sample, this);
+  }
+
+  void Close (void)
+  {
+    if (m_file)
+      {
+        std::fclose (m_file);
+        m_file = 0;
+      }
+  }
+
+private:
+  struct Metric
+  {
+    std::string name;
+    std::string labels;
+    bool counter;
+    Callback<double> read;
+    double total;
+    std::vector<double> ring;
+  };
+
+  MetricsRegistry ()
+    : m_file (0), m_lineProtocol (false), m_window (0), m_writeEvery (1), m_samples (0)
+  {
+  }
+
+  static double EventCount (void)
+  {
+    return Simulator::GetEventCount ();
+  }
+
+  uint32_t Add (std::string name, std::string labels, bool counter, Callback<double> read)
+  {
+    Metric m;
+    m.name = name;
+    m.labels = labels;
+    m.counter = counter;
+    m.read = read;
+    m.total = 0.0;
+    m.ring.assign (m_window, 0.0);
+    m_metrics.push_back (m);
+    return m_metrics.size () - 1;
+  }
+
+  void Sample (void)
+  {
+    uint32_t slot = m_samples % m_window;
+    for (std::vector<Metric>::iterator m = m_metrics.begin (); m != m_metrics.end (); ++m)
+      {
+        m->ring[slot] = m->read.IsNull () ? m->total : m->read ();
+      }
+    m_samples++;
+    if (m_samples % m_writeEvery == 0)
+      {
+        Write (slot);
+      }
+    Simulator::Schedule (m_interval, &MetricsRegistry::Sample, this);
+  }
+
+  void Write (uint32_t slot)
+  {
+    uint32_t n = std::min (m_samples, m_window);
+    uint32_t oldest = (slot + m_window - n + 1) % m_window;
+    double span = (n - 1) * m_interval.GetSeconds ();
+    double now = Simulator::Now ().GetSeconds ();
+    for (std::vector<Metric>::const_iterator m = m_metrics.begin (); m != m_metrics.end (); ++m)
+      {
+        double value = m->ring[slot];
+        double rate = 0.0;
+        double lo = std::numeric_limits<double>::max ();
+        double hi = -lo;
+        double sum = 0.0;
+        for (uint32_t k = 0; k < n; k++)
+          {
+            double v = m->ring[(oldest + k) % m_window];
+            lo = std::min (lo, v);
+            hi = std::max (hi, v);
+            sum += v;
+          }
+        if (m->counter && span > 0)
+          {
+            rate = (value - m->ring[oldest]) / span;
+          }
+        if (m_lineProtocol)
+          {
+            std::fprintf (m_file, "%s%s%s value=%.17g", m->name.c_str (), m->labels.empty () ? "" : ",",
+                          m->labels.c_str (), value);
+            if (m->counter)
+              {
+                std::fprintf (m_file, ",rate=%.17g", rate);
+              }
+            else
+              {
+                std::fprintf (m_file, ",min=%.17g,max=%.17g,mean=%.17g", lo, hi, sum / n);
+              }
+            std::fprintf (m_file, " %lld\n", static_cast<long long> (Simulator::Now ().GetNanoSeconds ()));
+          }
+        else
+          {
+            std::string labels = m->labels;
+            std::replace (labels.begin (), labels.end (), ',', ';');
+            if (m->counter)
+              {
+                std::fprintf (m_file, "%.9f,%s,%s,%.17g,%.17g,,,\n", now, m->name.c_str (), labels.c_str (), value,
+                              rate);
+              }
+            else
+              {
+                std::fprintf (m_file, "%.9f,%s,%s,%.17g,,%.17g,%.17g,%.17g\n", now, m->name.c_str (),
+                              labels.c_str (), value, lo, hi, sum / n);
+              }
+          }
+      }
+    std::fflush (m_file);
+  }
+
+  std::FILE *m_file;
+  bool m_lineProtocol;
+  Time m_interval;
+  uint32_t m_window;
+  uint32_t m_writeEvery;
+  uint32_t m_samples;
+  std::vector<Metric> m_metrics;
+};
+
+/*
+ * Metricas padrao por no: mensagens RIP/RIPng enviadas, TCs OLSR recebidos,
+ * pacotes nas filas dos devices e bytes entregues localmente (a vazao dos
+ * fluxos, no no de destino). Custa um parse de cabecalho por pacote IP
+ * enviado.
+ */
+class NodeMetrics
+{
+public:
+  void Install (NodeContainer nodes)
+  {
+    MetricsRegistry *registry = MetricsRegistry::Get ();
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        std::string labels = "node=" + Names::FindName (*n);
+        if (Names::FindName (*n).empty ())
+          {
+            std::ostringstream id;
+            id << "node=Node" << (*n)->GetId ();
+            labels = id.str ();
+          }
+        Ptr<Hooks> hooks = Create<Hooks> ();
+        hooks->node = *n;
+        hooks->rip = registry->AddCounter ("rip_tx", labels);
+        hooks->delivered = registry->AddCounter ("delivered_bytes", labels);
+        registry->AddGauge ("queue_packets", labels, MakeCallback (&Hooks::QueuePackets, hooks));
+        m_hooks.push_back (hooks);
+
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        if (ipv4)
+          {
+            ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&Hooks::Ipv4Tx, hooks));
+            ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&Hooks::Ipv4Deliver, hooks));
+            Ptr<olsr::RoutingProtocol> olsr = Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+            if (olsr)
+              {
+                hooks->olsrTc = registry->AddCounter ("olsr_tc_rx", labels);
+                olsr->TraceConnectWithoutContext ("Rx", MakeCallback (&Hooks::OlsrRx, hooks));
+              }
+          }
+        Ptr<Ipv6L3Protocol> ipv6 = (*n)->GetObject<Ipv6L3Protocol> ();
+        if (ipv6)
+          {
+            ipv6->TraceConnectWithoutContext ("Tx", MakeCallback (&Hooks::Ipv6Tx, hooks));
+            ipv6->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&Hooks::Ipv6Deliver, hooks));
+          }
+      }
+  }
+
+private:
+  struct Hooks : public SimpleRefCount<Hooks>
+  {
+    Hooks ()
+      : rip (0), delivered (0), olsrTc (0)
+    {
+    }
+
+    /* Porta UDP de destino apos o cabecalho IP, lida sem copiar o pacote. */
+    static bool DestinationPort (Ptr<const Packet> packet, uint32_t size, uint16_t port)
+    {
+      uint8_t head[64];
+      uint32_t end = size + 4;
+      if (packet->GetSize () < end || end > sizeof (head))
+        {
+          return false;
+        }
+      packet->CopyData (head, end);
+      return ((head[end - 2] << 8) | head[end - 1]) == port;
+    }
+
+    void Ipv4Tx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      Ipv4Header ip;
+      if (packet->PeekHeader (ip) && ip.GetProtocol () == UdpL4Protocol::PROT_NUMBER
+          && DestinationPort (packet, ip.GetSerializedSize (), 520))
+        {
+          MetricsRegistry::Get ()->Increment (rip);
+        }
+    }
+
+    void Ipv6Tx (Ptr<const Packet> packet, Ptr<Ipv6> ipv6, uint32_t interface)
+    {
+      Ipv6Header ip;
+      if (packet->PeekHeader (ip) && ip.GetNextHeader () == UdpL4Protocol::PROT_NUMBER
+          && DestinationPort (packet, ip.GetSerializedSize (), 521))
+        {
+          MetricsRegistry::Get ()->Increment (rip);
+        }
+    }
+
+    void Ipv4Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+    {
+      MetricsRegistry::Get ()->Increment (delivered, packet->GetSize ());
+    }
+
+    void Ipv6Deliver (const Ipv6Header &header, Ptr<const Packet> packet, uint32_t interface)
+    {
+      MetricsRegistry::Get ()->Increment (delivered, packet->GetSize ());
+    }
+
+    void OlsrRx (const olsr::PacketHeader &header, const olsr::MessageList &messages)
+    {
+      for (olsr::MessageList::const_iterator m = messages.begin (); m != messages.end (); ++m)
+        {
+          if (m->GetMessageType () == olsr::MessageHeader::TC_MESSAGE)
+            {
+              MetricsRegistry::Get ()->Increment (olsrTc);
+            }
+        }
+    }
+
+    double QueuePackets (void)
+    {
+      uint32_t packets = 0;
+      for (uint32_t i = 0; i < node->GetNDevices (); i++)
+        {
+          Ptr<CsmaNetDevice> csma = DynamicCast<CsmaNetDevice> (node->GetDevice (i));
+          Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice> (node->GetDevice (i));
+          if (csma)
+            {
+              packets += csma->GetQueue ()->GetNPackets ();
+            }
+          else if (p2p)
+            {
+              packets += p2p->GetQueue ()->GetNPackets ();
+            }
+        }
+      return packets;
+    }
+
+    Ptr<Node> node;
+    uint32_t rip;
+    uint32_t delivered;
+    uint32_t olsrTc;
+  };
+
+  std::vector<Ptr<Hooks> > m_hooks;
+};
+
+} // namespace ns3
+
+#endif /* METRICS_H */
@@ -0,0 +1,323 @@
+#ifndef NEIGHBOUR_COSTS_H
+#define NEIGHBOUR_COSTS_H
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/olsr-module.h"
+#include "ns3/rip.h"
+#include "ns3/rip-header.h"
+
+namespace ns3 {
+
+/*
+ * Distancia de cada vizinho de um roteador ate um destino, tirada do proprio
+ * protocolo de roteamento. Base do ECMP e do fast-reroute, que precisam de
+ * mais de um proximo salto quando o Rip/OLSR do ns-3 so guardam um.
+ *
+ *  - RIP: as responses recebidas de cada vizinho (metrica anunciada para o
+ *    prefixo mais especifico que cobre o destino), com metrica < 16 e idade
+ *    de no maximo um intervalo de atualizacao (UnsolicitedRoutingUpdate mais
+ *    o jitter de 50% do ns-3): um vizinho que deixou de anunciar o prefixo
+ *    sai na atualizacao periodica seguinte, nao so depois do TimeoutDelay.
+ *    Os anuncios ficam indexados por mascara, e a busca testa uma vez cada
+ *    mascara conhecida, da mais longa para a mais curta;
+ *  - OLSR: a distancia em saltos de cada vizinho adjacente (entradas da
+ *    tabela com distancia 1) ate um roteador ligado a sub-rede dest/mask
+ *    (0 se ele esta ligado a ela), calculada no grafo que o proprio no
+ *    conhece (vizinhos, vizinhos de 2 saltos, topology set, MID e HNA).
+ *    O resultado fica em cache ate o trace RoutingTableChanged do no.
+ *
+ * So entram vizinhos por interfaces ativas no proprio no; nada e lido de
+ * outros nos.
+ */
+class NeighbourCosts
+{
+public:
+  struct Cost
+  {
+    Ipv4Address gateway;
+    uint32_t interface;
+    uint32_t distance;
+  };
+
+  void SetIpv4 (Ptr<Ipv4> ipv4)
+  {
+    m_ipv4 = ipv4;
+    m_rip = Ipv4RoutingHelper::GetRouting<Rip> (ipv4->GetRoutingProtocol ());
+    m_olsr = Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+    NS_ABORT_MSG_UNLESS (m_rip || m_olsr, "Neighbour costs need RIP or OLSR");
+    if (m_rip)
+      {
+        TimeValue interval;
+        m_rip->GetAttribute ("UnsolicitedRoutingUpdate", interval);
+        m_maxAge = Seconds (interval.Get ().GetSeconds () * 1.5);
+        ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&NeighbourCosts::RipRx, this));
+      }
+    else
+      {
+        m_olsr->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&NeighbourCosts::OlsrChanged, this));
+      }
+  }
+
+  /* O destino esta numa sub-rede ligada diretamente ao no. */
+  bool IsConnected (Ipv4Address dest) const
+  {
+    for (uint32_t i = 1; i < m_ipv4->GetNInterfaces (); i++)
+      {
+        for (uint32_t j = 0; m_ipv4->IsUp (i) && j < m_ipv4->GetNAddresses (i); j++)
+          {
+            Ipv4InterfaceAddress addr = m_ipv4->GetAddress (i, j);
+            if (addr.GetMask ().IsMatch (addr.GetLocal (), dest))
+              {
+                return true;
+              }
+          }
+      }
+    return false;
+  }
+
+  /*
+   * A mascara so vale para o OLSR, cuja tabela tem rotas de host: e a da
+   * sub-rede do destino, para achar os roteadores ligados a ela.
+   */
+  std::vector<Cost> Get (Ipv4Address dest, Ipv4Mask mask = Ipv4Mask::GetOnes ())
+  {
+    std::vector<Cost> costs;
+    if (m_rip)
+      {
+        GetRip (dest, costs);
+      }
+    else
+      {
+        GetOlsr (dest, mask, costs);
+      }
+    return costs;
+  }
+
+  static uint32_t Min (const std::vector<Cost> &costs)
+  {
+    uint32_t best = std::numeric_limits<uint32_t>::max ();
+    for (std::vector<Cost>::const_iterator c = costs.begin (); c != costs.end (); ++c)
+      {
+        best = std::min (best, c->distance);
+      }
+    return best;
+  }
+
+private:
+  struct Advert
+  {
+    uint32_t metric;
+    Time time;
+  };
+
+  /* Anuncios RIP de um prefixo, por (gateway, interface). */
+  typedef std::map<std::pair<uint32_t, uint32_t>, Advert> Adverts;
+  /* Prefixos anunciados por mascara, da mais longa para a mais curta. */
+  typedef std::map<uint32_t, std::map<uint32_t, Adverts>, std::greater<uint32_t> > AdvertIndex;
+
+  void RipRx (const Ipv4Header &ip, Ptr<const Packet> packet, uint32_t interface)
+  {
+    UdpHeader udp;
+    if (ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER || !packet->PeekHeader (udp)
+        || udp.GetDestinationPort () != 520)
+      {
+        return;
+      }
+    Ptr<Packet> copy = packet->Copy ();
+    copy->RemoveHeader (udp);
+    RipHeader rip;
+    copy->RemoveHeader (rip);
+    if (rip.GetCommand () != RipHeader::RESPONSE)
+      {
+        return;
+      }
+    std::list<RipRte> rtes = rip.GetRteList ();
+    for (std::list<RipRte>::const_iterator r = rtes.begin (); r != rtes.end (); ++r)
+      {
+        Advert &advert = m_adverts[r->GetSubnetMask ().Get ()]
+                                  [r->GetPrefix ().CombineMask (r->GetSubnetMask ()).Get ()]
+                                  [std::make_pair (ip.GetSource ().Get (), interface)];
+        advert.metric = r->GetRouteMetric ();
+        advert.time = Simulator::Now ();
+      }
+  }
+
+  void GetRip (Ipv4Address dest, std::vector<Cost> &costs)
+  {
+    for (AdvertIndex::iterator m = m_adverts.begin (); m != m_adverts.end () && costs.empty (); ++m)
+      {
+        std::map<uint32_t, Adverts>::iterator p = m->second.find (dest.CombineMask (Ipv4Mask (m->first)).Get ());
+        if (p == m->second.end ())
+          {
+            continue;
+          }
+        for (Adverts::iterator a = p->second.begin (); a != p->second.end ();)
+          {
+            // Sem anuncio novo no ultimo intervalo: o vizinho deixou de anunciar
+            if (Simulator::Now () - a->second.time > m_maxAge)
+              {
+                p->second.erase (a++);
+                continue;
+              }
+            if (a->second.metric < 16 && m_ipv4->IsUp (a->first.second))
+              {
+                Cost cost;
+                cost.gateway = Ipv4Address (a->first.first);
+                cost.interface = a->first.second;
+                cost.distance = a->second.metric;
+                costs.push_back (cost);
+              }
+            ++a;
+          }
+        if (p->second.empty ())
+          {
+            m->second.erase (p);
+          }
+      }
+  }
+
+  void OlsrChanged (uint32_t size)
+  {
+    m_olsrCosts.clear ();
+  }
+
+  void GetOlsr (Ipv4Address dest, Ipv4Mask mask, std::vector<Cost> &costs)
+  {
+    std::pair<uint32_t, uint32_t> key (dest.CombineMask (mask).Get (), mask.Get ());
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<Cost> >::iterator cached = m_olsrCosts.find (key);
+    if (cached == m_olsrCosts.end ())
+      {
+        cached = m_olsrCosts.insert (std::make_pair (key, OlsrCandidates (dest, mask))).first;
+      }
+    for (std::vector<Cost>::const_iterator c = cached->second.begin (); c != cached->second.end (); ++c)
+      {
+        if (m_ipv4->IsUp (c->interface))
+          {
+            costs.push_back (*c);
+          }
+      }
+  }
+
+  /* Endereco principal OLSR de um endereco de interface, na visao do no. */
+  Ipv4Address MainAddress (Ipv4Address addr) const
+  {
+    if (m_ipv4->GetInterfaceForAddress (addr) >= 0)
+      {
+        return m_ipv4->GetAddress (1, 0).GetLocal ();
+      }
+    const olsr::IfaceAssocSet &assoc = m_olsr->GetOlsrState ().GetIfaceAssocSet ();
+    for (olsr::IfaceAssocSet::const_iterator t = assoc.begin (); t != assoc.end (); ++t)
+      {
+        if (t->ifaceAddr == addr)
+          {
+            return t->mainAddr;
+          }
+      }
+    return addr;
+  }
+
+  /*
+   * Vizinhos adjacentes com a distancia ate a sub-rede de dest, por busca em
+   * largura a partir dos roteadores ligados a ela no grafo OLSR do no.
+   */
+  std::vector<Cost> OlsrCandidates (Ipv4Address dest, Ipv4Mask mask)
+  {
+    std::map<Ipv4Address, std::set<Ipv4Address> > links;
+    Ipv4Address self = MainAddress (m_ipv4->GetAddress (1, 0).GetLocal ());
+    const olsr::NeighborSet &neighbours = m_olsr->GetNeighbors ();
+    for (olsr::NeighborSet::const_iterator t = neighbours.begin (); t != neighbours.end (); ++t)
+      {
+        if (t->status == olsr::NeighborTuple::STATUS_SYM)
+          {
+            links[self].insert (t->neighborMainAddr);
+            links[t->neighborMainAddr].insert (self);
+          }
+      }
+    const olsr::TwoHopNeighborSet &twoHop = m_olsr->GetTwoHopNeighbors ();
+    for (olsr::TwoHopNeighborSet::const_iterator t = twoHop.begin (); t != twoHop.end (); ++t)
+      {
+        Ipv4Address far = MainAddress (t->twoHopNeighborAddr);
+        links[t->neighborMainAddr].insert (far);
+        links[far].insert (t->neighborMainAddr);
+      }
+    const olsr::TopologySet &topology = m_olsr->GetTopologySet ();
+    for (olsr::TopologySet::const_iterator t = topology.begin (); t != topology.end (); ++t)
+      {
+        Ipv4Address last = MainAddress (t->lastAddr);
+        Ipv4Address far = MainAddress (t->destAddr);
+        links[last].insert (far);
+        links[far].insert (last);
+      }
+
+    // Roteadores ligados a sub-rede: donos dos enderecos da tabela que caem
+    // nela, e gateways HNA que anunciam uma rede que contem o destino
+    std::map<Ipv4Address, uint32_t> hops;
+    std::vector<Ipv4Address> queue;
+    std::vector<olsr::RoutingTableEntry> entries = m_olsr->GetRoutingTableEntries ();
+    for (std::vector<olsr::RoutingTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+      {
+        Ipv4Address owner = MainAddress (e->destAddr);
+        if (mask.IsMatch (e->destAddr, dest) && hops.insert (std::make_pair (owner, 0)).second)
+          {
+            queue.push_back (owner);
+          }
+      }
+    const olsr::AssociationSet &hna = m_olsr->GetOlsrState ().GetAssociationSet ();
+    for (olsr::AssociationSet::const_iterator t = hna.begin (); t != hna.end (); ++t)
+      {
+        if (t->netmask.IsMatch (t->networkAddr, dest) && hops.insert (std::make_pair (t->gatewayAddr, 0)).second)
+          {
+            queue.push_back (t->gatewayAddr);
+          }
+      }
+    for (uint32_t q = 0; q < queue.size (); q++)
+      {
+        const std::set<Ipv4Address> &next = links[queue[q]];
+        for (std::set<Ipv4Address>::const_iterator n = next.begin (); n != next.end (); ++n)
+          {
+            if (hops.insert (std::make_pair (*n, hops[queue[q]] + 1)).second)
+              {
+                queue.push_back (*n);
+              }
+          }
+      }
+
+    // Vizinhos adjacentes: entradas a um salto, pela interface da entrada
+    std::vector<Cost> candidates;
+    for (std::vector<olsr::RoutingTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+      {
+        std::map<Ipv4Address, uint32_t>::const_iterator h = hops.find (MainAddress (e->destAddr));
+        if (e->destAddr != e->nextAddr || h == hops.end ())
+          {
+            continue;
+          }
+        Cost cost;
+        cost.gateway = e->nextAddr;
+        cost.interface = e->interface;
+        cost.distance = h->second;
+        candidates.push_back (cost);
+      }
+    return candidates;
+  }
+
+  Ptr<Ipv4> m_ipv4;
+  Ptr<Rip> m_rip;
+  Ptr<olsr::RoutingProtocol> m_olsr;
+  Time m_maxAge;
+  AdvertIndex m_adverts;
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<Cost> > m_olsrCosts;
+};
+
+} // namespace ns3
+
+#endif /* NEIGHBOUR_COSTS_H */
@@ -0,0 +1,345 @@
+#ifndef PATH_TRACER_H
+#define PATH_TRACER_H
+
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/* Marca de um pacote amostrado pelo PathTracer. */
+class PathTag : public Tag
+{
+public:
+  PathTag ()
+    : m_id (0)
+  {
+  }
+
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::PathTag").SetParent<Tag> ().AddConstructor<PathTag> ();
+    return tid;
+  }
+
+  virtual TypeId GetInstanceTypeId (void) const
+  {
+    return GetTypeId ();
+  }
+
+  virtual uint32_t GetSerializedSize (void) const
+  {
+    return 4;
+  }
+
+  virtual void Serialize (TagBuffer i) const
+  {
+    i.WriteU32 (m_id);
+  }
+
+  virtual void Deserialize (TagBuffer i)
+  {
+    m_id = i.ReadU32 ();
+  }
+
+  virtual void Print (std::ostream &os) const
+  {
+    os << "path=" << m_id;
+  }
+
+  void SetId (uint32_t id)
+  {
+    m_id = id;
+  }
+
+  uint32_t GetId (void) const
+  {
+    return m_id;
+  }
+
+private:
+  uint32_t m_id;
+};
+
+/*
+ * Caminho real de uma fracao dos pacotes UDP de aplicacao (IPv4) gerados
+ * pelos nos de origem: cada pacote amostrado ganha um PathTag ao sair e os
+ * traces do Ipv4L3Protocol de todos os nos registram cada salto (no,
+ * interface de entrada e de saida, instante). Pacotes sem a marca custam
+ * um PeekPacketTag por evento.
+ *
+ * A amostragem e deterministica (um a cada 1/fraction), para nao consumir
+ * streams aleatorios. Cada pacote termina como
+ *
+ *   delivered     entregue sem repetir no
+ *   loop          passou duas vezes pelo mesmo no (TTL esgotado ou entregue)
+ *   blackhole     descartado sem rota ou em interface desligada
+ *   drop          outro descarte no IP
+ *   lost          sumiu depois do ultimo salto (fila, enlace cortado) ou
+ *                 ainda estava em transito no fim
+ *
+ * e vai para um CSV (id,flow,sent_s,outcome,delay_ms,hops). O resumo lista,
+ * por fluxo, as epocas de caminho: cada troca de caminho (incluindo os
+ * pacotes que terminam num loop ou blackhole) abre uma epoca, com intervalo,
+ * pacotes e latencia media de cada salto.
+ */
+class PathTracer
+{
+public:
+  PathTracer ()
+    : m_fraction (0), m_credit (0), m_nextId (1), m_sampled (0)
+  {
+  }
+
+  void Install (NodeContainer sources, NodeContainer nodes, double fraction, std::string fileName)
+  {
+    m_fraction = fraction;
+    m_file.open (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (m_file.is_open (), "Cannot open path trace file " << fileName);
+    m_file << "id,flow,sent_s,outcome,delay_ms,hops" << std::endl;
+    for (NodeContainer::Iterator n = sources.Begin (); n != sources.End (); ++n)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        NS_ABORT_MSG_UNLESS (ipv4, "The path tracer needs IPv4 sources");
+        ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeBoundCallback (&PathTracer::Send, this, *n));
+      }
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        if (!ipv4)
+          {
+            continue;
+          }
+        ipv4->TraceConnectWithoutContext ("Rx", MakeBoundCallback (&PathTracer::Receive, this, *n));
+        ipv4->TraceConnectWithoutContext ("UnicastForward", MakeBoundCallback (&PathTracer::Forward, this, *n));
+        ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeBoundCallback (&PathTracer::Deliver, this, *n));
+        ipv4->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&PathTracer::Dropped, this, *n));
+      }
+  }
+
+  /* Fecha como lost o que ainda esta em transito e imprime as epocas. */
+  void Print (std::ostream &os)
+  {
+    while (!m_open.empty ())
+      {
+        Finish (m_open.begin ()->first, "lost");
+      }
+    m_file.close ();
+    os << "Path trace (fraction " << m_fraction << "): sampled=" << m_sampled;
+    for (std::map<std::string, uint64_t>::const_iterator it = m_outcomes.begin (); it != m_outcomes.end (); ++it)
+      {
+        os << " " << it->first << "=" << it->second;
+      }
+    os << std::endl;
+    for (std::vector<Epoch>::const_iterator e = m_epochs.begin (); e != m_epochs.end (); ++e)
+      {
+        os << "  " << e->flow << " " << e->first.GetSeconds () << "-" << e->last.GetSeconds () << "s packets="
+           << e->packets << " " << e->path;
+        for (uint32_t k = 0; k < e->hopSum.size (); k++)
+          {
+            os << (k ? "," : " hops(ms)=") << e->hopSum[k] * 1000 / e->packets;
+          }
+        os << std::endl;
+      }
+  }
+
+private:
+  struct Hop
+  {
+    Ptr<Node> node;
+    int32_t in;
+    int32_t out;
+    Time t;
+  };
+
+  struct Trace
+  {
+    std::string flow;
+    bool looped;
+    std::vector<Hop> hops;
+  };
+
+  struct Epoch
+  {
+    std::string flow;
+    std::string path;
+    Time first;
+    Time last;
+    uint32_t packets;
+    std::vector<double> hopSum;
+  };
+
+  static bool Tagged (Ptr<const Packet> packet, uint32_t &id)
+  {
+    PathTag tag;
+    if (!packet->PeekPacketTag (tag))
+      {
+        return false;
+      }
+    id = tag.GetId ();
+    return true;
+  }
+
+  static void Send (PathTracer *self, Ptr<Node> node, const Ipv4Header &header, Ptr<const Packet> packet,
+                    uint32_t interface)
+  {
+    UdpHeader udp;
+    if (header.GetProtocol () != UdpL4Protocol::PROT_NUMBER || header.GetDestination ().IsMulticast ()
+        || header.GetDestination ().IsBroadcast () || !packet->PeekHeader (udp))
+      {
+        return;
+      }
+    self->m_credit += self->m_fraction;
+    if (self->m_credit < 1.0)
+      {
+        return;
+      }
+    self->m_credit -= 1.0;
+    PathTag tag;
+    tag.SetId (self->m_nextId++);
+    packet->AddPacketTag (tag);
+    self->m_sampled++;
+
+    std::ostringstream flow;
+    flow << Names::FindName (node) << "->" << header.GetDestination () << ":" << udp.GetDestinationPort ();
+    Trace &trace = self->m_open[tag.GetId ()];
+    trace.flow = flow.str ();
+    trace.looped = false;
+    Hop hop = { node, -1, static_cast<int32_t> (interface), Simulator::Now () };
+    trace.hops.push_back (hop);
+  }
+
+  static void Receive (PathTracer *self, Ptr<Node> node, Ptr<const Packet> packet, Ptr<Ipv4> ipv4,
+                       uint32_t interface)
+  {
+    uint32_t id;
+    if (!Tagged (packet, id) || !self->m_open.count (id))
+      {
+        return;
+      }
+    Trace &trace = self->m_open[id];
+    for (std::vector<Hop>::const_iterator h = trace.hops.begin (); h != trace.hops.end (); ++h)
+      {
+        trace.looped = trace.looped || h->node == node;
+      }
+    Hop hop = { node, static_cast<int32_t> (interface), -1, Simulator::Now () };
+    trace.hops.push_back (hop);
+  }
+
+  static void Forward (PathTracer *self, Ptr<Node> node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       uint32_t interface)
+  {
+    uint32_t id;
+    if (Tagged (packet, id) && self->m_open.count (id) && self->m_open[id].hops.back ().node == node)
+      {
+        self->m_open[id].hops.back ().out = interface;
+      }
+  }
+
+  static void Deliver (PathTracer *self, Ptr<Node> node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       uint32_t interface)
+  {
+    uint32_t id;
+    if (Tagged (packet, id) && self->m_open.count (id))
+      {
+        self->Finish (id, self->m_open[id].looped ? "loop" : "delivered");
+      }
+  }
+
+  static void Dropped (PathTracer *self, Ptr<Node> node, const Ipv4Header &header, Ptr<const Packet> packet,
+                       Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    uint32_t id;
+    if (!Tagged (packet, id) || !self->m_open.count (id))
+      {
+        return;
+      }
+    if (reason == Ipv4L3Protocol::DROP_TTL_EXPIRED || self->m_open[id].looped)
+      {
+        self->Finish (id, "loop");
+      }
+    else if (reason == Ipv4L3Protocol::DROP_NO_ROUTE || reason == Ipv4L3Protocol::DROP_INTERFACE_DOWN)
+      {
+        self->Finish (id, "blackhole");
+      }
+    else
+      {
+        self->Finish (id, "drop");
+      }
+  }
+
+  void Finish (uint32_t id, std::string outcome)
+  {
+    Trace &trace = m_open[id];
+    const std::vector<Hop> &hops = trace.hops;
+    m_outcomes[outcome]++;
+
+    std::ostringstream path;
+    std::ostringstream csvHops;
+    for (uint32_t k = 0; k < hops.size (); k++)
+      {
+        path << (k ? ">" : "") << Names::FindName (hops[k].node);
+        csvHops << (k ? ";" : "") << Names::FindName (hops[k].node) << ":";
+        if (hops[k].in >= 0)
+          {
+            csvHops << hops[k].in;
+          }
+        csvHops << "/";
+        if (hops[k].out >= 0)
+          {
+            csvHops << hops[k].out;
+          }
+        csvHops << "@" << hops[k].t.GetSeconds ();
+      }
+    if (outcome != "delivered")
+      {
+        path << " [" << outcome << "]";
+      }
+    Time sent = hops.front ().t;
+    m_file << id << "," << trace.flow << "," << sent.GetSeconds () << "," << outcome << ","
+           << (hops.back ().t - sent).GetSeconds () * 1000 << "," << csvHops.str () << "\n";
+
+    std::map<std::string, uint32_t>::iterator current = m_current.find (trace.flow);
+    if (current == m_current.end () || m_epochs[current->second].path != path.str ())
+      {
+        Epoch e;
+        e.flow = trace.flow;
+        e.path = path.str ();
+        e.first = sent;
+        e.packets = 0;
+        e.hopSum.assign (hops.size () - 1, 0.0);
+        m_current[trace.flow] = m_epochs.size ();
+        m_epochs.push_back (e);
+        current = m_current.find (trace.flow);
+      }
+    Epoch &e = m_epochs[current->second];
+    e.last = sent;
+    e.packets++;
+    for (uint32_t k = 1; k < hops.size () && k - 1 < e.hopSum.size (); k++)
+      {
+        e.hopSum[k - 1] += (hops[k].t - hops[k - 1].t).GetSeconds ();
+      }
+    m_open.erase (id);
+  }
+
+  double m_fraction;
+  double m_credit;
+  uint32_t m_nextId;
+  uint64_t m_sampled;
+  std::ofstream m_file;
+  std::map<uint32_t, Trace> m_open;
+  std::map<std::string, uint64_t> m_outcomes;
+  std::vector<Epoch> m_epochs;
+  std::map<std::string, uint32_t> m_current;
+};
+
+} // namespace ns3
+
+#endif /* PATH_TRACER_H */
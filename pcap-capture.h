@@ -0,0 +1,296 @@
+#ifndef PCAP_CAPTURE_H
+#define PCAP_CAPTURE_H
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+namespace ns3 {
+
+/*
+ * Captura pcap alternativa ao EnablePcapAll, por device CSMA/PointToPoint
+ * (PromiscSniffer, como o helper em modo promiscuo).
+ *
+ *  - stream: grava direto em <prefix>-<no>-<device>.pcap, cortando cada
+ *    pacote em snapLen e abrindo <prefix>-<no>-<device>.<n>.pcap quando o
+ *    arquivo passa de rotateBytes ou fica aberto mais que rotateTime;
+ *  - ring: guarda so os ultimos ringPackets pacotes de cada interface em
+ *    memoria (referencias aos buffers do ns-3, sem copia) e so grava quando
+ *    um gatilho dispara (queda de enlace, descarte no IP). A gravacao espera
+ *    postTrigger depois do gatilho para pegar tambem o que vem depois da
+ *    falha e sai em <prefix>-trigger<k>-<no>-<device>.pcap. Gatilhos que
+ *    chegam com uma gravacao pendente entram nela; depois do gatilho que abre
+ *    uma gravacao, os do mesmo motivo sao ignorados (e contados) por holdoff,
+ *    para uma rajada de descartes nao virar um arquivo por postTrigger.
+ */
+class PcapCapture
+{
+public:
+  PcapCapture ()
+    : m_ring (false), m_snapLen (65535), m_rotateBytes (0), m_ringPackets (1000), m_flushPending (false),
+      m_triggers (0), m_suppressed (0), m_flushes (0), m_records (0), m_bytes (0), m_files (0)
+  {
+  }
+
+  void SetSnapLen (uint32_t snapLen)
+  {
+    m_snapLen = snapLen;
+  }
+
+  /* Zero desliga o criterio correspondente. */
+  void SetRotation (uint64_t bytes, Time time)
+  {
+    m_rotateBytes = bytes;
+    m_rotateTime = time;
+  }
+
+  void SetRing (uint32_t packets, Time postTrigger, Time holdoff)
+  {
+    m_ring = true;
+    m_ringPackets = packets;
+    m_postTrigger = postTrigger;
+    m_holdoff = holdoff;
+  }
+
+  void Install (NodeContainer nodes, std::string prefix)
+  {
+    m_prefix = prefix;
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = (*n)->GetDevice (i);
+            Ptr<Capture> c = Create<Capture> ();
+            if (DynamicCast<CsmaNetDevice> (dev))
+              {
+                c->dataLinkType = PcapHelper::DLT_EN10MB;
+              }
+            else if (DynamicCast<PointToPointNetDevice> (dev))
+              {
+                c->dataLinkType = PcapHelper::DLT_PPP;
+              }
+            else
+              {
+                continue;
+              }
+            c->device = dev;
+            dev->TraceConnectWithoutContext ("PromiscSniffer", MakeBoundCallback (&PcapCapture::Sniff, this, c));
+            m_captures.push_back (c);
+          }
+      }
+  }
+
+  /* Descartes no IPv4/IPv6 dos nos tambem disparam a gravacao do ring. */
+  void TriggerOnDrop (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        if ((*n)->GetObject<Ipv4L3Protocol> ())
+          {
+            (*n)->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+              "Drop", MakeCallback (&PcapCapture::Ipv4Drop, this));
+          }
+        if ((*n)->GetObject<Ipv6L3Protocol> ())
+          {
+            (*n)->GetObject<Ipv6L3Protocol> ()->TraceConnectWithoutContext (
+              "Drop", MakeCallback (&PcapCapture::Ipv6Drop, this));
+          }
+      }
+  }
+
+  void Trigger (std::string reason)
+  {
+    if (!m_ring)
+      {
+        return;
+      }
+    if (m_flushPending)
+      {
+        m_triggers++;
+        return;
+      }
+    std::map<std::string, Time>::const_iterator last = m_lastTrigger.find (reason);
+    if (last != m_lastTrigger.end () && Simulator::Now () - last->second < m_holdoff)
+      {
+        m_suppressed++;
+        return;
+      }
+    m_triggers++;
+    m_lastTrigger[reason] = Simulator::Now ();
+    m_flushPending = true;
+    m_reason = reason;
+    Simulator::Schedule (m_postTrigger, &PcapCapture::Flush, this);
+  }
+
+  /* Grava o que ainda esta pendente e resume a captura. */
+  void Print (std::ostream &os)
+  {
+    if (m_flushPending)
+      {
+        Flush ();
+      }
+    os << "Pcap capture (" << (m_ring ? "ring" : "stream") << ", snaplen=" << m_snapLen << ")" << std::endl;
+    os << "  records=" << m_records << " bytes=" << m_bytes << " files=" << m_files;
+    if (m_ring)
+      {
+        os << " triggers=" << m_triggers << " suppressed=" << m_suppressed << " flushes=" << m_flushes;
+      }
+    os << std::endl;
+    for (std::vector<std::string>::const_iterator it = m_flushLog.begin (); it != m_flushLog.end (); ++it)
+      {
+        os << "  " << *it << std::endl;
+      }
+  }
+
+private:
+  struct Capture : public SimpleRefCount<Capture>
+  {
+    Capture ()
+      : dataLinkType (0), open (false), index (0), fileBytes (0)
+    {
+    }
+
+    Ptr<NetDevice> device;
+    uint32_t dataLinkType;
+    PcapFile file;
+    bool open;
+    uint32_t index;
+    uint64_t fileBytes;
+    Time opened;
+    std::deque<std::pair<Time, Ptr<const Packet> > > ring;
+  };
+
+  static void Sniff (PcapCapture *self, Ptr<Capture> c, Ptr<const Packet> packet)
+  {
+    if (self->m_ring)
+      {
+        c->ring.push_back (std::make_pair (Simulator::Now (), packet));
+        if (c->ring.size () > self->m_ringPackets)
+          {
+            c->ring.pop_front ();
+          }
+        return;
+      }
+    if (c->open && ((self->m_rotateBytes && c->fileBytes >= self->m_rotateBytes)
+                    || (self->m_rotateTime.IsStrictlyPositive () && Simulator::Now () - c->opened >= self->m_rotateTime)))
+      {
+        c->file.Close ();
+        c->open = false;
+        c->index++;
+      }
+    if (!c->open)
+      {
+        std::ostringstream name;
+        name << self->m_prefix << "-" << c->device->GetNode ()->GetId () << "-" << c->device->GetIfIndex ();
+        if (c->index)
+          {
+            name << "." << c->index;
+          }
+        name << ".pcap";
+        self->Open (c->file, name.str (), c->dataLinkType);
+        c->open = true;
+        c->opened = Simulator::Now ();
+        c->fileBytes = 24;
+      }
+    c->fileBytes += self->Write (c->file, Simulator::Now (), packet);
+  }
+
+  void Ipv4Drop (const Ipv4Header &header, Ptr<const Packet> packet, Ipv4L3Protocol::DropReason reason,
+                 Ptr<Ipv4> ipv4, uint32_t interface)
+  {
+    Trigger ("drop");
+  }
+
+  void Ipv6Drop (const Ipv6Header &header, Ptr<const Packet> packet, Ipv6L3Protocol::DropReason reason,
+                 Ptr<Ipv6> ipv6, uint32_t interface)
+  {
+    Trigger ("drop");
+  }
+
+  void Open (PcapFile &file, std::string name, uint32_t dataLinkType)
+  {
+    file.Open (name, std::ios::out | std::ios::binary);
+    file.Init (dataLinkType, m_snapLen);
+    m_files++;
+    m_bytes += 24;
+  }
+
+  uint32_t Write (PcapFile &file, Time t, Ptr<const Packet> packet)
+  {
+    uint64_t us = t.GetMicroSeconds ();
+    file.Write (us / 1000000, us % 1000000, packet);
+    uint32_t bytes = 16 + std::min (packet->GetSize (), m_snapLen);
+    m_records++;
+    m_bytes += bytes;
+    return bytes;
+  }
+
+  void Flush (void)
+  {
+    if (!m_flushPending)
+      {
+        return;
+      }
+    m_flushPending = false;
+    m_flushes++;
+    uint64_t records = m_records;
+    for (std::vector<Ptr<Capture> >::iterator it = m_captures.begin (); it != m_captures.end (); ++it)
+      {
+        Ptr<Capture> c = *it;
+        if (c->ring.empty ())
+          {
+            continue;
+          }
+        std::ostringstream name;
+        name << m_prefix << "-trigger" << m_flushes << "-" << c->device->GetNode ()->GetId () << "-"
+             << c->device->GetIfIndex () << ".pcap";
+        PcapFile file;
+        Open (file, name.str (), c->dataLinkType);
+        for (std::deque<std::pair<Time, Ptr<const Packet> > >::const_iterator r = c->ring.begin ();
+             r != c->ring.end (); ++r)
+          {
+            Write (file, r->first, r->second);
+          }
+        file.Close ();
+        c->ring.clear ();
+      }
+    std::ostringstream log;
+    log << "trigger" << m_flushes << " " << m_reason << " flushed at " << Simulator::Now ().GetSeconds ()
+        << "s records=" << m_records - records;
+    m_flushLog.push_back (log.str ());
+  }
+
+  std::string m_prefix;
+  bool m_ring;
+  uint32_t m_snapLen;
+  uint64_t m_rotateBytes;
+  Time m_rotateTime;
+  uint32_t m_ringPackets;
+  Time m_postTrigger;
+  Time m_holdoff;
+  bool m_flushPending;
+  std::string m_reason;
+  std::vector<Ptr<Capture> > m_captures;
+  std::vector<std::string> m_flushLog;
+  std::map<std::string, Time> m_lastTrigger;
+  uint64_t m_triggers;
+  uint64_t m_suppressed;
+  uint64_t m_flushes;
+  uint64_t m_records;
+  uint64_t m_bytes;
+  uint64_t m_files;
+};
+
+} // namespace ns3
+
+#endif /* PCAP_CAPTURE_H */
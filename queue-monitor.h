@@ -0,0 +1,182 @@
+#ifndef QUEUE_MONITOR_H
+#define QUEUE_MONITOR_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <vector>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+
+namespace ns3 {
+
+/*
+ * Instrumentacao das filas de transmissao dos NetDevices CSMA e PointToPoint.
+ *
+ * Os contadores (enqueue, dequeue, drop) sao atualizados pelos trace sources
+ * da Queue de cada device; a ocupacao e amostrada em intervalos fixos e
+ * gravada como serie temporal CSV:
+ *
+ *   time,node,ifIndex,packets,bytes,enqueued,dequeued,dropped
+ *
+ * O tempo de permanencia na fila (sojourn) vai para um histograma em escala
+ * log2 de milissegundos: o bucket 0 conta < 1 ms, o bucket i conta
+ * [2^(i-1), 2^i) ms e o ultimo bucket acumula o restante.
+ */
+class QueueMonitor
+{
+public:
+  static const uint32_t SOJOURN_BUCKETS = 12;
+
+  /* Instala contadores em todo device CSMA/PointToPoint dos nos dados. */
+  void Install (NodeContainer nodes)
+  {
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+          {
+            Install ((*n)->GetDevice (i));
+          }
+      }
+  }
+
+  void Install (Ptr<NetDevice> device)
+  {
+    Ptr<Queue<Packet> > queue;
+    Ptr<CsmaNetDevice> csmaDev = DynamicCast<CsmaNetDevice> (device);
+    Ptr<PointToPointNetDevice> p2pDev = DynamicCast<PointToPointNetDevice> (device);
+    if (csmaDev)
+      {
+        queue = csmaDev->GetQueue ();
+      }
+    else if (p2pDev)
+      {
+        queue = p2pDev->GetQueue ();
+      }
+    if (!queue)
+      {
+        return;
+      }
+
+    Ptr<DeviceStats> stats = Create<DeviceStats> ();
+    stats->queue = queue;
+    stats->node = Names::FindName (device->GetNode ());
+    if (stats->node.empty ())
+      {
+        std::ostringstream oss;
+        oss << "Node" << device->GetNode ()->GetId ();
+        stats->node = oss.str ();
+      }
+    stats->ifIndex = device->GetIfIndex ();
+    queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DeviceStats::Enqueue, stats));
+    queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DeviceStats::Dequeue, stats));
+    queue->TraceConnectWithoutContext ("Drop", MakeCallback (&DeviceStats::Drop, stats));
+    m_stats.push_back (stats);
+  }
+
+  /* Comeca a amostragem periodica; a primeira amostra e tirada em t=0. */
+  void Start (Time interval, std::string fileName)
+  {
+    m_interval = interval;
+    m_file.open (fileName.c_str ());
+    m_file << "time,node,ifIndex,packets,bytes,enqueued,dequeued,dropped" << std::endl;
+    Simulator::ScheduleNow (&QueueMonitor::Sample, this);
+  }
+
+  /* Resumo por device: maximo observado, drops e histograma de sojourn. */
+  void Print (std::ostream &os) const
+  {
+    os << "Queue statistics (sojourn buckets: <1ms, <2ms, <4ms, ... ms)" << std::endl;
+    for (std::vector<Ptr<DeviceStats> >::const_iterator it = m_stats.begin (); it != m_stats.end (); ++it)
+      {
+        Ptr<DeviceStats> s = *it;
+        os << "  " << s->node << "/" << s->ifIndex
+           << " enq=" << s->enqueued
+           << " deq=" << s->dequeued
+           << " drop=" << s->dropped
+           << " maxPackets=" << s->maxPackets
+           << " sojourn=[";
+        for (uint32_t b = 0; b < SOJOURN_BUCKETS; b++)
+          {
+            os << (b ? " " : "") << s->sojourn[b];
+          }
+        os << "]" << std::endl;
+      }
+  }
+
+private:
+  struct DeviceStats : public SimpleRefCount<DeviceStats>
+  {
+    DeviceStats ()
+      : ifIndex (0), enqueued (0), dequeued (0), dropped (0), maxPackets (0),
+        sojourn (SOJOURN_BUCKETS, 0)
+    {
+    }
+
+    void Enqueue (Ptr<const Packet> p)
+    {
+      enqueued++;
+      // A fila do device e FIFO (DropTail): a ordem de chegada e a de saida
+      arrivals.push_back (Simulator::Now ());
+      maxPackets = std::max (maxPackets, queue->GetNPackets ());
+    }
+
+    void Dequeue (Ptr<const Packet> p)
+    {
+      dequeued++;
+      if (arrivals.empty ())
+        {
+          return;
+        }
+      int64_t us = (Simulator::Now () - arrivals.front ()).GetMicroSeconds ();
+      arrivals.pop_front ();
+      uint32_t bucket = 0;
+      for (int64_t limit = 1000; us >= limit && bucket < SOJOURN_BUCKETS - 1; limit *= 2)
+        {
+          bucket++;
+        }
+      sojourn[bucket]++;
+    }
+
+    void Drop (Ptr<const Packet> p)
+    {
+      dropped++;
+    }
+
+    Ptr<Queue<Packet> > queue;
+    std::string node;
+    uint32_t ifIndex;
+    uint64_t enqueued;
+    uint64_t dequeued;
+    uint64_t dropped;
+    uint32_t maxPackets;
+    std::deque<Time> arrivals;
+    std::vector<uint64_t> sojourn;
+  };
+
+  void Sample (void)
+  {
+    double now = Simulator::Now ().GetSeconds ();
+    for (std::vector<Ptr<DeviceStats> >::const_iterator it = m_stats.begin (); it != m_stats.end (); ++it)
+      {
+        Ptr<DeviceStats> s = *it;
+        m_file << now << "," << s->node << "," << s->ifIndex << ","
+               << s->queue->GetNPackets () << "," << s->queue->GetNBytes () << ","
+               << s->enqueued << "," << s->dequeued << "," << s->dropped << "\n";
+      }
+    Simulator::Schedule (m_interval, &QueueMonitor::Sample, this);
+  }
+
+  std::vector<Ptr<DeviceStats> > m_stats;
+  std::ofstream m_file;
+  Time m_interval;
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_MONITOR_H */
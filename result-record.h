@@ -0,0 +1,312 @@
+#ifndef RESULT_RECORD_H
+#define RESULT_RECORD_H
+
+#include <fcntl.h>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+
+namespace ns3 {
+
+/*
+ * Interrupcao do fluxo principal causada pela falha, medida no destino:
+ * ultimo pacote entregue antes da falha e primeiro depois dela (pacotes UDP
+ * para a porta do fluxo, entregues pelo IPv4 ou IPv6 do no).
+ */
+class OutageProbe
+{
+public:
+  OutageProbe ()
+    : m_port (0), m_delivered (0)
+  {
+  }
+
+  void Install (Ptr<Node> dst, uint16_t port, Time failure)
+  {
+    m_port = port;
+    m_failure = failure;
+    m_lastBefore = Seconds (-1);
+    m_firstAfter = Seconds (-1);
+    if (dst->GetObject<Ipv4L3Protocol> ())
+      {
+        dst->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+          "LocalDeliver", MakeCallback (&OutageProbe::Ipv4Deliver, this));
+      }
+    if (dst->GetObject<Ipv6L3Protocol> ())
+      {
+        dst->GetObject<Ipv6L3Protocol> ()->TraceConnectWithoutContext (
+          "LocalDeliver", MakeCallback (&OutageProbe::Ipv6Deliver, this));
+      }
+  }
+
+  Time GetFailure (void) const
+  {
+    return m_failure;
+  }
+
+  /* Falha ate o primeiro pacote depois dela; negativo se nao voltou. */
+  Time GetRecovery (void) const
+  {
+    return m_firstAfter.IsNegative () ? Seconds (-1) : m_firstAfter - m_failure;
+  }
+
+  /* Intervalo sem entregas que contem a falha. */
+  Time GetGap (void) const
+  {
+    return m_firstAfter.IsNegative () || m_lastBefore.IsNegative () ? Seconds (-1) : m_firstAfter - m_lastBefore;
+  }
+
+  uint64_t GetDelivered (void) const
+  {
+    return m_delivered;
+  }
+
+private:
+  void Deliver (Ptr<const Packet> packet, uint8_t protocol)
+  {
+    UdpHeader udp;
+    if (protocol != UdpL4Protocol::PROT_NUMBER || !packet->PeekHeader (udp) || udp.GetDestinationPort () != m_port)
+      {
+        return;
+      }
+    m_delivered++;
+    Time now = Simulator::Now ();
+    if (now < m_failure)
+      {
+        m_lastBefore = now;
+      }
+    else if (m_firstAfter.IsNegative ())
+      {
+        m_firstAfter = now;
+      }
+  }
+
+  void Ipv4Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Deliver (packet, header.GetProtocol ());
+  }
+
+  void Ipv6Deliver (const Ipv6Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Deliver (packet, header.GetNextHeader ());
+  }
+
+  uint16_t m_port;
+  Time m_failure;
+  Time m_lastBefore;
+  Time m_firstAfter;
+  uint64_t m_delivered;
+};
+
+/*
+ * Registro de resultado de uma execucao, uma linha JSON acrescentada a um
+ * arquivo compartilhado por todas as execucoes (tools/results-query.py
+ * consulta e agrega). Campos:
+ *
+ *   key      cenario-config-s<seed>-r<run>-<unix>-<pid>, unico por execucao
+ *   config   hash dos parametros sem seed/run/results: agrupa as replicas
+ *   params   os --nome=valor da linha de comando
+ *   seed, run
+ *   outage   failure_s, recovery_s, gap_s, delivered (OutageProbe)
+ *   flows    por fluxo: tx, rx, lost, loss_pct, delay_ms, jitter_ms,
+ *            throughput_kbps
+ *   perf     events, wall_s, peak_rss_kb, sim_s
+ *   ...      secoes de outros modulos (SetSection)
+ *
+ * A linha e escrita com um unico write em O_APPEND, entao execucoes
+ * simultaneas podem usar o mesmo arquivo.
+ */
+class ResultRecord
+{
+public:
+  ResultRecord (std::string scenario, int argc, char **argv)
+    : m_scenario (scenario), m_seed (0), m_run (0)
+  {
+    for (int i = 1; i < argc; i++)
+      {
+        std::string arg = argv[i];
+        if (arg.compare (0, 2, "--") != 0)
+          {
+            continue;
+          }
+        std::string::size_type eq = arg.find ('=');
+        if (eq == std::string::npos)
+          {
+            m_params[arg.substr (2)] = "true";
+          }
+        else
+          {
+            m_params[arg.substr (2, eq - 2)] = arg.substr (eq + 1);
+          }
+      }
+    gettimeofday (&m_start, 0);
+  }
+
+  void SetSeed (uint32_t seed, uint64_t run)
+  {
+    m_seed = seed;
+    m_run = run;
+  }
+
+  void SetOutage (const OutageProbe &probe)
+  {
+    std::ostringstream os;
+    os << "{\"failure_s\": " << Number (probe.GetFailure ().GetSeconds ())
+       << ", \"recovery_s\": " << Number (probe.GetRecovery ().GetSeconds ())
+       << ", \"gap_s\": " << Number (probe.GetGap ().GetSeconds ())
+       << ", \"delivered\": " << probe.GetDelivered () << "}";
+    m_outage = os.str ();
+  }
+
+  template <class Classifier>
+  void SetFlows (Ptr<FlowMonitor> monitor, Ptr<Classifier> classifier)
+  {
+    monitor->CheckForLostPackets ();
+    std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
+    std::ostringstream os;
+    os << "[";
+    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator it = stats.begin (); it != stats.end (); ++it)
+      {
+        typename Classifier::FiveTuple t = classifier->FindFlow (it->first);
+        const FlowMonitor::FlowStats &s = it->second;
+        double duration = (s.timeLastRxPacket - s.timeFirstTxPacket).GetSeconds ();
+        std::ostringstream src;
+        std::ostringstream dst;
+        src << t.sourceAddress << ":" << t.sourcePort;
+        dst << t.destinationAddress << ":" << t.destinationPort;
+        os << (it == stats.begin () ? "" : ", ") << "{\"id\": " << it->first
+           << ", \"src\": " << Quote (src.str ()) << ", \"dst\": " << Quote (dst.str ())
+           << ", \"tx\": " << s.txPackets << ", \"rx\": " << s.rxPackets << ", \"lost\": " << s.lostPackets
+           << ", \"loss_pct\": " << Number (s.txPackets ? 100.0 * s.lostPackets / s.txPackets : 0.0)
+           << ", \"delay_ms\": " << Number (s.rxPackets ? s.delaySum.GetSeconds () * 1000 / s.rxPackets : 0.0)
+           << ", \"jitter_ms\": "
+           << Number (s.rxPackets > 1 ? s.jitterSum.GetSeconds () * 1000 / (s.rxPackets - 1) : 0.0)
+           << ", \"throughput_kbps\": " << Number (duration > 0 ? s.rxBytes * 8.0 / duration / 1000 : 0.0) << "}";
+      }
+    os << "]";
+    m_flows = os.str ();
+  }
+
+  /* Secao extra do registro, um objeto JSON de outro modulo. */
+  void SetSection (std::string name, std::string json)
+  {
+    m_sections[name] = json;
+  }
+
+  /* Chamar logo depois do Simulator::Run. */
+  void SetPerf (void)
+  {
+    struct timeval end;
+    gettimeofday (&end, 0);
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    std::ostringstream os;
+    os << "{\"events\": " << Simulator::GetEventCount ()
+       << ", \"wall_s\": " << Number ((end.tv_sec - m_start.tv_sec) + (end.tv_usec - m_start.tv_usec) / 1e6)
+       << ", \"peak_rss_kb\": " << usage.ru_maxrss
+       << ", \"sim_s\": " << Number (Simulator::Now ().GetSeconds ()) << "}";
+    m_perf = os.str ();
+  }
+
+  void Append (std::string fileName) const
+  {
+    std::ostringstream line;
+    line << "{\"key\": " << Quote (Key ()) << ", \"scenario\": " << Quote (m_scenario)
+         << ", \"config\": " << Quote (Config ()) << ", \"seed\": " << m_seed << ", \"run\": " << m_run
+         << ", \"params\": {";
+    for (std::map<std::string, std::string>::const_iterator it = m_params.begin (); it != m_params.end (); ++it)
+      {
+        line << (it == m_params.begin () ? "" : ", ") << Quote (it->first) << ": " << Quote (it->second);
+      }
+    line << "}";
+    line << ", \"outage\": " << (m_outage.empty () ? "null" : m_outage);
+    line << ", \"flows\": " << (m_flows.empty () ? "[]" : m_flows);
+    line << ", \"perf\": " << (m_perf.empty () ? "null" : m_perf);
+    for (std::map<std::string, std::string>::const_iterator it = m_sections.begin (); it != m_sections.end (); ++it)
+      {
+        line << ", " << Quote (it->first) << ": " << it->second;
+      }
+    line << "}\n";
+
+    std::string data = line.str ();
+    int fd = open (fileName.c_str (), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    NS_ABORT_MSG_IF (fd < 0, "Cannot open results file " << fileName);
+    ssize_t written = write (fd, data.data (), data.size ());
+    close (fd);
+    NS_ABORT_MSG_UNLESS (written == static_cast<ssize_t> (data.size ()), "Short write to results file " << fileName);
+  }
+
+  std::string Key (void) const
+  {
+    std::ostringstream os;
+    os << m_scenario << "-" << Config () << "-s" << m_seed << "-r" << m_run << "-" << m_start.tv_sec << "-" << getpid ();
+    return os.str ();
+  }
+
+  /* FNV-1a dos parametros que nao mudam entre replicas. */
+  std::string Config (void) const
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::map<std::string, std::string>::const_iterator it = m_params.begin (); it != m_params.end (); ++it)
+      {
+        if (it->first == "seed" || it->first == "run" || it->first == "results")
+          {
+            continue;
+          }
+        std::string kv = it->first + "=" + it->second + ";";
+        for (std::string::const_iterator c = kv.begin (); c != kv.end (); ++c)
+          {
+            hash ^= static_cast<unsigned char> (*c);
+            hash *= 1099511628211ULL;
+          }
+      }
+    std::ostringstream os;
+    os << std::hex << std::setw (8) << std::setfill ('0') << (hash & 0xffffffff);
+    return os.str ();
+  }
+
+private:
+  static std::string Quote (std::string s)
+  {
+    std::string out = "\"";
+    for (std::string::const_iterator c = s.begin (); c != s.end (); ++c)
+      {
+        if (*c == '"' || *c == '\\')
+          {
+            out += '\\';
+          }
+        out += *c;
+      }
+    return out + "\"";
+  }
+
+  static std::string Number (double v)
+  {
+    std::ostringstream os;
+    os << std::setprecision (9) << v;
+    return os.str ();
+  }
+
+  std::string m_scenario;
+  std::map<std::string, std::string> m_params;
+  uint32_t m_seed;
+  uint64_t m_run;
+  struct timeval m_start;
+  std::string m_outage;
+  std::string m_flows;
+  std::string m_perf;
+  std::map<std::string, std::string> m_sections;
+};
+
+} // namespace ns3
+
+#endif /* RESULT_RECORD_H */
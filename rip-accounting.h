@@ -0,0 +1,260 @@
+#ifndef RIP_ACCOUNTING_H
+#define RIP_ACCOUNTING_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/rip.h"
+#include "ns3/rip-header.h"
+#include "ns3/ripng.h"
+#include "ns3/ripng-header.h"
+#include "route-changes.h"
+
+namespace ns3 {
+
+/*
+ * Contabilidade do plano de controle RIP (ou RIPng) por roteador.
+ *
+ * O Rip e o RipNg do ns-3 nao tem trace sources, entao as mensagens sao
+ * contadas olhando os pacotes UDP/520 (UDP/521 no RIPng) nos traces Tx/Rx
+ * do Ipv4L3Protocol/Ipv6L3Protocol: requests e responses enviados/recebidos
+ * e RTEs enviadas/processadas. O cabecalho IP e a porta UDP sao lidos sem
+ * copiar o pacote; so as mensagens RIP sao copiadas.
+ *
+ * Responses multicast sao classificadas como periodicas quando saem pelo
+ * menos 0.9 * UnsolicitedRoutingUpdate depois da rodada periodica anterior
+ * do mesmo no (ou na primeira rodada, e na mesma rodada por outras
+ * interfaces); as demais sao atualizacoes disparadas. Responses unicast
+ * sao respostas a requests.
+ *
+ * Mudancas de tabela sao as rotas adicionadas, removidas ou modificadas
+ * contadas por um RouteChangeLog sem saida, com as mudancas de cada
+ * roteador agrupadas numa janela de window.
+ */
+class RipAccounting
+{
+public:
+  void Install (NodeContainer routers, Time window)
+  {
+    for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+      {
+        Ptr<Counters> counters = Create<Counters> ();
+        counters->node = *it;
+        TimeValue unsolicited;
+        Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol> ();
+        if (ipv4)
+          {
+            Ptr<Rip> rip = Ipv4RoutingHelper::GetRouting<Rip> (ipv4->GetRoutingProtocol ());
+            NS_ABORT_MSG_UNLESS (rip, "RIP accounting installed on a node without RIP");
+            rip->GetAttribute ("UnsolicitedRoutingUpdate", unsolicited);
+            ipv4->TraceConnectWithoutContext ("Tx", MakeCallback (&Counters::Tx, counters));
+            ipv4->TraceConnectWithoutContext ("Rx", MakeCallback (&Counters::Rx, counters));
+          }
+        else
+          {
+            Ptr<Ipv6L3Protocol> ipv6 = (*it)->GetObject<Ipv6L3Protocol> ();
+            Ptr<RipNg> ripNg = Ipv6RoutingHelper::GetRouting<RipNg> (ipv6->GetRoutingProtocol ());
+            NS_ABORT_MSG_UNLESS (ripNg, "RIP accounting installed on a node without RIPng");
+            ripNg->GetAttribute ("UnsolicitedRoutingUpdate", unsolicited);
+            ipv6->TraceConnectWithoutContext ("Tx", MakeCallback (&Counters::Tx6, counters));
+            ipv6->TraceConnectWithoutContext ("Rx", MakeCallback (&Counters::Rx6, counters));
+          }
+        counters->gap = Seconds (0.9 * unsolicited.Get ().GetSeconds ());
+        m_counters.push_back (counters);
+      }
+    m_routeChanges.Install (routers, window);
+  }
+
+  void Print (std::ostream &os, std::string splitHorizon) const
+  {
+    os << "RIP accounting (" << splitHorizon << ")" << std::endl;
+    os << "  node reqTx reqRx respTx respRx periodicTx triggeredTx rteTx rteRx tableChanges" << std::endl;
+    Counters total;
+    for (std::vector<Ptr<Counters> >::const_iterator it = m_counters.begin (); it != m_counters.end (); ++it)
+      {
+        Ptr<Counters> c = *it;
+        c->tableChanges = m_routeChanges.GetChanges (c->node);
+        os << "  " << Names::FindName (c->node);
+        c->PrintValues (os);
+        total.Add (*c);
+      }
+    os << "  total";
+    total.PrintValues (os);
+  }
+
+private:
+  struct Counters : public SimpleRefCount<Counters>
+  {
+    Counters ()
+      : requestsTx (0), requestsRx (0), responsesTx (0), responsesRx (0),
+        periodicTx (0), triggeredTx (0), rtesTx (0), rtesRx (0), tableChanges (0),
+        lastPeriodic (Seconds (-1))
+    {
+    }
+
+    /* Porta UDP de destino logo apos um cabecalho IP de size bytes. */
+    static bool DestinationPort (Ptr<const Packet> packet, uint32_t size, uint16_t port)
+    {
+      uint8_t head[64];
+      uint32_t end = size + 4;
+      if (packet->GetSize () < end || end > sizeof (head))
+        {
+          return false;
+        }
+      packet->CopyData (head, end);
+      return ((head[end - 2] << 8) | head[end - 1]) == port;
+    }
+
+    bool Parse (Ptr<const Packet> packet, Ipv4Header &ip, RipHeader &rip)
+    {
+      if (!packet->PeekHeader (ip) || ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER
+          || !DestinationPort (packet, ip.GetSerializedSize (), 520))
+        {
+          return false;
+        }
+      Ptr<Packet> copy = packet->Copy ();
+      copy->RemoveHeader (ip);
+      UdpHeader udp;
+      copy->RemoveHeader (udp);
+      copy->RemoveHeader (rip);
+      return true;
+    }
+
+    bool Parse6 (Ptr<const Packet> packet, Ipv6Header &ip, RipNgHeader &rip)
+    {
+      if (!packet->PeekHeader (ip) || ip.GetNextHeader () != UdpL4Protocol::PROT_NUMBER
+          || !DestinationPort (packet, ip.GetSerializedSize (), 521))
+        {
+          return false;
+        }
+      Ptr<Packet> copy = packet->Copy ();
+      copy->RemoveHeader (ip);
+      UdpHeader udp;
+      copy->RemoveHeader (udp);
+      copy->RemoveHeader (rip);
+      return true;
+    }
+
+    void Tx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      Ipv4Header ip;
+      RipHeader rip;
+      if (Parse (packet, ip, rip))
+        {
+          CountTx (rip.GetCommand () == RipHeader::REQUEST, rip.GetRteNumber (),
+                   ip.GetDestination ().IsMulticast ());
+        }
+    }
+
+    void Tx6 (Ptr<const Packet> packet, Ptr<Ipv6> ipv6, uint32_t interface)
+    {
+      Ipv6Header ip;
+      RipNgHeader rip;
+      if (Parse6 (packet, ip, rip))
+        {
+          CountTx (rip.GetCommand () == RipNgHeader::REQUEST, rip.GetRteNumber (),
+                   ip.GetDestinationAddress ().IsMulticast ());
+        }
+    }
+
+    void CountTx (bool request, uint16_t rtes, bool multicast)
+    {
+      if (request)
+        {
+          requestsTx++;
+          return;
+        }
+      responsesTx++;
+      rtesTx += rtes;
+      if (!multicast)
+        {
+          return;
+        }
+      Time now = Simulator::Now ();
+      if (lastPeriodic.IsNegative () || now == lastPeriodic || now - lastPeriodic >= gap)
+        {
+          lastPeriodic = now;
+          periodicTx++;
+        }
+      else
+        {
+          triggeredTx++;
+        }
+    }
+
+    void Rx (Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+    {
+      Ipv4Header ip;
+      RipHeader rip;
+      if (Parse (packet, ip, rip))
+        {
+          CountRx (rip.GetCommand () == RipHeader::REQUEST, rip.GetRteNumber ());
+        }
+    }
+
+    void Rx6 (Ptr<const Packet> packet, Ptr<Ipv6> ipv6, uint32_t interface)
+    {
+      Ipv6Header ip;
+      RipNgHeader rip;
+      if (Parse6 (packet, ip, rip))
+        {
+          CountRx (rip.GetCommand () == RipNgHeader::REQUEST, rip.GetRteNumber ());
+        }
+    }
+
+    void CountRx (bool request, uint16_t rtes)
+    {
+      if (request)
+        {
+          requestsRx++;
+          return;
+        }
+      responsesRx++;
+      rtesRx += rtes;
+    }
+
+    void Add (const Counters &o)
+    {
+      requestsTx += o.requestsTx;
+      requestsRx += o.requestsRx;
+      responsesTx += o.responsesTx;
+      responsesRx += o.responsesRx;
+      periodicTx += o.periodicTx;
+      triggeredTx += o.triggeredTx;
+      rtesTx += o.rtesTx;
+      rtesRx += o.rtesRx;
+      tableChanges += o.tableChanges;
+    }
+
+    void PrintValues (std::ostream &os) const
+    {
+      os << " " << requestsTx << " " << requestsRx << " " << responsesTx << " " << responsesRx
+         << " " << periodicTx << " " << triggeredTx << " " << rtesTx << " " << rtesRx
+         << " " << tableChanges << std::endl;
+    }
+
+    Ptr<Node> node;
+    uint64_t requestsTx;
+    uint64_t requestsRx;
+    uint64_t responsesTx;
+    uint64_t responsesRx;
+    uint64_t periodicTx;
+    uint64_t triggeredTx;
+    uint64_t rtesTx;
+    uint64_t rtesRx;
+    uint64_t tableChanges;
+    Time lastPeriodic;
+    Time gap;
+  };
+
+  std::vector<Ptr<Counters> > m_counters;
+  RouteChangeLog m_routeChanges;
+};
+
+} // namespace ns3
+
+#endif /* RIP_ACCOUNTING_H */
@@ -0,0 +1,630 @@
+#ifndef ROUTE_CHANGES_H
+#define ROUTE_CHANGES_H
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/olsr-routing-protocol.h"
+#include "ns3/rip-header.h"
+#include "ns3/ripng-header.h"
+
+namespace ns3 {
+
+/*
+ * Alternativa ao PrintRoutingTableAt: em vez de tabelas inteiras em tempos
+ * fixos, imprime so as rotas adicionadas, removidas ou modificadas, quando
+ * mudam:
+ *
+ *   Route 41.3s RouterB add Rip 10.0.2.0/24 via 10.0.1.1 if 1 metric -
+ *   Route 41.3s RouterB mod olsr::RoutingProtocol ... -> ...
+ *   Route 41.3s RouterB del Ipv4StaticRouting ...
+ *
+ * A tabela de cada no e uma copia estruturada, por protocolo da lista:
+ * o roteamento estatico e lido por GetNRoutes/GetRoute, o OLSR por
+ * GetRoutingTableEntries. O RIP e o RIPng do ns-3 nao expoem as rotas, entao
+ * a copia deles e o RouteOutput do proprio protocolo para cada sub-rede da
+ * topologia (gateway e interface; a metrica nao aparece, "-").
+ *
+ * O RIP nao avisa quando a tabela muda: o gatilho e uma response RIP
+ * recebida ou enviada (UDP/520 ou 521, lida nos traces LocalDeliver e
+ * SendOutgoing; so pacotes RIP sao copiados). Cada RTE guarda a metrica
+ * anunciada por (interface, remetente ou o proprio no, prefixo), e so os
+ * prefixos cuja metrica anunciada mudou sao sondados de novo; as responses
+ * periodicas sem mudanca nao custam sondagem. A copia completa, com todas as
+ * sub-redes da topologia, e feita uma vez, na primeira comparacao. No OLSR o
+ * gatilho e o trace RoutingTableChanged; as tabelas estaticas e do OLSR sao
+ * lidas inteiras, e a comparacao cobre so as chaves lidas ou sondadas.
+ *
+ * O primeiro gatilho agenda a comparacao do no para window depois e os
+ * seguintes ate la sao absorvidos, entao o tempo impresso atrasa no maximo
+ * window. CheckAll compara todos os nos na hora, sondando tambem as
+ * sub-redes ligadas a cada no, e serve para eventos sem mensagem, como a
+ * queda de um enlace.
+ */
+class RouteChangeLog
+{
+public:
+  RouteChangeLog ()
+    : m_os (0), m_subnetsRead (false)
+  {
+  }
+
+  void Install (NodeContainer routers, std::ostream &os, Time window = MilliSeconds (100))
+  {
+    m_os = &os;
+    Install (routers, window);
+  }
+
+  /* Sem saida: so conta as mudancas (GetChanges, Print). */
+  void Install (NodeContainer routers, Time window)
+  {
+    m_window = window;
+    for (NodeContainer::Iterator n = routers.Begin (); n != routers.End (); ++n)
+      {
+        Ptr<Router> r = Create<Router> ();
+        r->node = *n;
+        r->ipv4 = (*n)->GetObject<Ipv4> ();
+        r->ipv6 = (*n)->GetObject<Ipv6> ();
+        r->log = this;
+        r->index = m_routers.size ();
+        m_routers.push_back (r);
+        Ptr<Ipv4L3Protocol> ipv4 = (*n)->GetObject<Ipv4L3Protocol> ();
+        Ptr<Ipv6L3Protocol> ipv6 = (*n)->GetObject<Ipv6L3Protocol> ();
+        if (ipv4)
+          {
+            Ptr<olsr::RoutingProtocol> olsr =
+              Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (ipv4->GetRoutingProtocol ());
+            if (olsr)
+              {
+                olsr->TraceConnectWithoutContext ("RoutingTableChanged", MakeCallback (&Router::OlsrChanged, r));
+              }
+            else
+              {
+                ipv4->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&Router::Ipv4Packet, r));
+                ipv4->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&Router::Ipv4Packet, r));
+              }
+          }
+        else if (ipv6)
+          {
+            ipv6->TraceConnectWithoutContext ("SendOutgoing", MakeCallback (&Router::Ipv6Packet, r));
+            ipv6->TraceConnectWithoutContext ("LocalDeliver", MakeCallback (&Router::Ipv6Packet, r));
+          }
+      }
+  }
+
+  void CheckAll (void)
+  {
+    for (uint32_t i = 0; i < m_routers.size (); i++)
+      {
+        m_routers[i]->MarkConnected ();
+        Check (i);
+      }
+  }
+
+  /* Rotas adicionadas, removidas ou modificadas no no. */
+  uint64_t GetChanges (Ptr<Node> node) const
+  {
+    for (std::vector<Ptr<Router> >::const_iterator it = m_routers.begin (); it != m_routers.end (); ++it)
+      {
+        if ((*it)->node == node)
+          {
+            return (*it)->added + (*it)->removed + (*it)->modified;
+          }
+      }
+    return 0;
+  }
+
+  /*
+   * Secao "routing" do registro do run: ultima mudanca em qualquer roteador,
+   * quanto depois da falha ela veio (0 se nenhuma mudanca veio depois) e o
+   * total de rotas adicionadas, removidas ou modificadas.
+   */
+  std::string ToJson (Time failure) const
+  {
+    Time last;
+    uint64_t changes = 0;
+    for (std::vector<Ptr<Router> >::const_iterator it = m_routers.begin (); it != m_routers.end (); ++it)
+      {
+        last = Max (last, (*it)->lastChange);
+        changes += (*it)->added + (*it)->removed + (*it)->modified;
+      }
+    std::ostringstream os;
+    os << "{\"last_change_s\": " << last.GetSeconds ()
+       << ", \"convergence_s\": " << (last > failure ? (last - failure).GetSeconds () : 0.0)
+       << ", \"changes\": " << changes << "}";
+    return os.str ();
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Routing table changes" << std::endl;
+    Time last;
+    for (std::vector<Ptr<Router> >::const_iterator it = m_routers.begin (); it != m_routers.end (); ++it)
+      {
+        Ptr<Router> r = *it;
+        last = Max (last, r->lastChange);
+        if (m_routers.size () <= 16)
+          {
+            os << "  " << Names::FindName (r->node) << " added=" << r->added << " removed=" << r->removed
+               << " modified=" << r->modified << " routes=" << r->table.size ()
+               << " lastChange=" << r->lastChange.GetSeconds () << "s" << std::endl;
+          }
+      }
+    os << "  last change at " << last.GetSeconds () << "s" << std::endl;
+  }
+
+private:
+  /* Uma rota da copia; metric -1 quando o protocolo nao a informa. */
+  struct Entry
+  {
+    std::string gateway;
+    int32_t interface;
+    int32_t metric;
+
+    bool operator== (const Entry &other) const
+    {
+      return gateway == other.gateway && interface == other.interface && metric == other.metric;
+    }
+    bool operator!= (const Entry &other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  /* Chaveada por protocolo e destino/prefixo, ordenada para a comparacao. */
+  typedef std::map<std::string, Entry> Table;
+
+  struct Router : public SimpleRefCount<Router>
+  {
+    Router ()
+      : log (0), index (0), pending (false), probed (false), added (0), removed (0), modified (0)
+    {
+    }
+
+    void Ipv4Packet (const Ipv4Header &ip, Ptr<const Packet> packet, uint32_t interface)
+    {
+      UdpHeader udp;
+      if (ip.GetProtocol () != UdpL4Protocol::PROT_NUMBER || !packet->PeekHeader (udp)
+          || udp.GetDestinationPort () != 520)
+        {
+          return;
+        }
+      Ptr<Packet> copy = packet->Copy ();
+      copy->RemoveHeader (udp);
+      RipHeader rip;
+      copy->RemoveHeader (rip);
+      if (rip.GetCommand () != RipHeader::RESPONSE)
+        {
+          return;
+        }
+      bool sent = ipv4->GetInterfaceForAddress (ip.GetSource ()) >= 0;
+      std::list<RipRte> rtes = rip.GetRteList ();
+      for (std::list<RipRte>::const_iterator e = rtes.begin (); e != rtes.end (); ++e)
+        {
+          std::pair<uint32_t, uint32_t> prefix (e->GetPrefix ().CombineMask (e->GetSubnetMask ()).Get (),
+                                                e->GetSubnetMask ().GetPrefixLength ());
+          if (Advertised (interface, sent, ip.GetSource (), Ipv4Address (prefix.first), prefix.second,
+                          e->GetRouteMetric ()))
+            {
+              dirty.insert (prefix);
+            }
+        }
+      if (!dirty.empty ())
+        {
+          Schedule ();
+        }
+    }
+
+    void Ipv6Packet (const Ipv6Header &ip, Ptr<const Packet> packet, uint32_t interface)
+    {
+      UdpHeader udp;
+      if (ip.GetNextHeader () != UdpL4Protocol::PROT_NUMBER || !packet->PeekHeader (udp)
+          || udp.GetDestinationPort () != 521)
+        {
+          return;
+        }
+      Ptr<Packet> copy = packet->Copy ();
+      copy->RemoveHeader (udp);
+      RipNgHeader rip;
+      copy->RemoveHeader (rip);
+      if (rip.GetCommand () != RipNgHeader::RESPONSE)
+        {
+          return;
+        }
+      bool sent = ipv6->GetInterfaceForAddress (ip.GetSourceAddress ()) >= 0;
+      std::list<RipNgRte> rtes = rip.GetRteList ();
+      for (std::list<RipNgRte>::const_iterator e = rtes.begin (); e != rtes.end (); ++e)
+        {
+          std::pair<Ipv6Address, uint32_t> prefix (e->GetPrefix ().CombinePrefix (Ipv6Prefix (e->GetPrefixLen ())),
+                                                   e->GetPrefixLen ());
+          if (Advertised (interface, sent, ip.GetSourceAddress (), prefix.first, prefix.second,
+                          e->GetRouteMetric ()))
+            {
+              dirty6.insert (prefix);
+            }
+        }
+      if (!dirty6.empty ())
+        {
+          Schedule ();
+        }
+    }
+
+    /*
+     * Guarda a metrica anunciada (no que o no envia, o remetente e "self");
+     * verdadeiro se ela mudou desde o anuncio anterior da mesma chave.
+     */
+    template <typename A>
+    bool Advertised (uint32_t interface, bool sent, A sender, A prefix, uint32_t length, uint32_t metric)
+    {
+      std::ostringstream key;
+      key << interface << " ";
+      if (sent)
+        {
+          key << "self";
+        }
+      else
+        {
+          key << sender;
+        }
+      key << " " << prefix << "/" << length;
+      std::pair<std::map<std::string, uint32_t>::iterator, bool> it =
+        adverts.insert (std::make_pair (key.str (), metric));
+      if (!it.second && it.first->second == metric)
+        {
+          return false;
+        }
+      it.first->second = metric;
+      return true;
+    }
+
+    /* Sub-redes ligadas ao no, que mudam sem mensagem quando um enlace cai. */
+    void MarkConnected (void)
+    {
+      for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+        {
+          for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+            {
+              Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+              dirty.insert (std::make_pair (addr.GetLocal ().CombineMask (addr.GetMask ()).Get (),
+                                            (uint32_t) addr.GetMask ().GetPrefixLength ()));
+            }
+        }
+      for (uint32_t i = 1; ipv6 && i < ipv6->GetNInterfaces (); i++)
+        {
+          for (uint32_t j = 0; j < ipv6->GetNAddresses (i); j++)
+            {
+              Ipv6InterfaceAddress addr = ipv6->GetAddress (i, j);
+              if (addr.GetScope () == Ipv6InterfaceAddress::GLOBAL)
+                {
+                  dirty6.insert (std::make_pair (addr.GetAddress ().CombinePrefix (addr.GetPrefix ()),
+                                                 (uint32_t) addr.GetPrefix ().GetPrefixLength ()));
+                }
+            }
+        }
+    }
+
+    void OlsrChanged (uint32_t size)
+    {
+      Schedule ();
+    }
+
+    void Schedule (void)
+    {
+      if (!pending)
+        {
+          pending = true;
+          Simulator::Schedule (log->m_window, &RouteChangeLog::Check, log, index);
+        }
+    }
+
+    Ptr<Node> node;
+    Ptr<Ipv4> ipv4;
+    Ptr<Ipv6> ipv6;
+    RouteChangeLog *log;
+    uint32_t index;
+    bool pending;
+    bool probed;
+    std::map<std::string, uint32_t> adverts;
+    std::set<std::pair<uint32_t, uint32_t> > dirty;
+    std::set<std::pair<Ipv6Address, uint32_t> > dirty6;
+    Table table;
+    uint64_t added;
+    uint64_t removed;
+    uint64_t modified;
+    Time lastChange;
+  };
+
+  static std::string Name (Ptr<Object> protocol)
+  {
+    std::string name = protocol->GetInstanceTypeId ().GetName ();
+    return name.compare (0, 5, "ns3::") == 0 ? name.substr (5) : name;
+  }
+
+  template <typename A>
+  static std::string Key (const std::string &protocol, A dest, uint32_t length)
+  {
+    std::ostringstream key;
+    key << protocol << " " << dest << "/" << length;
+    return key.str ();
+  }
+
+  template <typename A>
+  static Entry MakeEntry (A gateway, int32_t interface, int32_t metric)
+  {
+    std::ostringstream via;
+    via << gateway;
+    Entry e;
+    e.gateway = via.str ();
+    e.interface = interface;
+    e.metric = metric;
+    return e;
+  }
+
+  template <typename A>
+  static void Add (Table &table, const std::string &protocol, A dest, uint32_t length, A gateway,
+                   int32_t interface, int32_t metric)
+  {
+    table[Key (protocol, dest, length)] = MakeEntry (gateway, interface, metric);
+  }
+
+  static void Write (std::ostream &os, const std::string &key, const Entry &e)
+  {
+    os << key << " via " << e.gateway << " if " << e.interface << " metric ";
+    if (e.metric < 0)
+      {
+        os << "-";
+      }
+    else
+      {
+        os << e.metric;
+      }
+  }
+
+  /* Sub-redes da topologia, para a primeira copia do RIP e do RIPng. */
+  void Subnets (void)
+  {
+    for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+      {
+        Ptr<Ipv4> ipv4 = NodeList::GetNode (n)->GetObject<Ipv4> ();
+        for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+          {
+            for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+              {
+                Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+                m_subnets.push_back (std::make_pair (addr.GetLocal ().CombineMask (addr.GetMask ()).Get (),
+                                                     (uint32_t) addr.GetMask ().GetPrefixLength ()));
+              }
+          }
+        Ptr<Ipv6> ipv6 = NodeList::GetNode (n)->GetObject<Ipv6> ();
+        for (uint32_t i = 1; ipv6 && i < ipv6->GetNInterfaces (); i++)
+          {
+            for (uint32_t j = 0; j < ipv6->GetNAddresses (i); j++)
+              {
+                Ipv6InterfaceAddress addr = ipv6->GetAddress (i, j);
+                if (addr.GetScope () == Ipv6InterfaceAddress::GLOBAL)
+                  {
+                    m_subnets6.push_back (std::make_pair (addr.GetAddress ().CombinePrefix (addr.GetPrefix ()),
+                                                          (uint32_t) addr.GetPrefix ().GetPrefixLength ()));
+                  }
+              }
+          }
+      }
+    std::sort (m_subnets.begin (), m_subnets.end ());
+    m_subnets.erase (std::unique (m_subnets.begin (), m_subnets.end ()), m_subnets.end ());
+    std::sort (m_subnets6.begin (), m_subnets6.end ());
+    m_subnets6.erase (std::unique (m_subnets6.begin (), m_subnets6.end ()), m_subnets6.end ());
+    m_subnetsRead = true;
+  }
+
+  /* Le o no: estatico e OLSR inteiros, RIP so nos prefixos marcados. */
+  void Snapshot (Ptr<Router> r)
+  {
+    Ptr<Ipv4> ipv4 = r->ipv4;
+    Ptr<Ipv4RoutingProtocol> root = ipv4->GetRoutingProtocol ();
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (root);
+    uint32_t count = list ? list->GetNRoutingProtocols () : 1;
+    for (uint32_t i = 0; i < count; i++)
+      {
+        int16_t priority;
+        Ptr<Ipv4RoutingProtocol> protocol = list ? list->GetRoutingProtocol (i, priority) : root;
+        std::string name = Name (protocol);
+        Ptr<Ipv4StaticRouting> staticRouting = DynamicCast<Ipv4StaticRouting> (protocol);
+        Ptr<olsr::RoutingProtocol> olsr = DynamicCast<olsr::RoutingProtocol> (protocol);
+        Table table;
+        if (staticRouting)
+          {
+            for (uint32_t k = 0; k < staticRouting->GetNRoutes (); k++)
+              {
+                Ipv4RoutingTableEntry route = staticRouting->GetRoute (k);
+                Add (table, name, route.GetDest (), route.GetDestNetworkMask ().GetPrefixLength (),
+                     route.GetGateway (), route.GetInterface (), staticRouting->GetMetric (k));
+              }
+            Replace (r, name, table);
+          }
+        else if (olsr)
+          {
+            std::vector<olsr::RoutingTableEntry> entries = olsr->GetRoutingTableEntries ();
+            for (uint32_t k = 0; k < entries.size (); k++)
+              {
+                Add (table, name, entries[k].destAddr, 32, entries[k].nextAddr, entries[k].interface,
+                     entries[k].distance);
+              }
+            Replace (r, name, table);
+          }
+        else
+          {
+            Socket::SocketErrno err;
+            for (std::set<std::pair<uint32_t, uint32_t> >::const_iterator s = r->dirty.begin ();
+                 s != r->dirty.end (); ++s)
+              {
+                Ipv4Header header;
+                header.SetDestination (Ipv4Address (s->first));
+                Ptr<Ipv4Route> route = protocol->RouteOutput (Create<Packet> (), header, 0, err);
+                Entry e;
+                if (route)
+                  {
+                    e = MakeEntry (route->GetGateway (), ipv4->GetInterfaceForDevice (route->GetOutputDevice ()), -1);
+                  }
+                Update (r, Key (name, Ipv4Address (s->first), s->second), route ? &e : 0);
+              }
+          }
+      }
+  }
+
+  void Snapshot6 (Ptr<Router> r)
+  {
+    Ptr<Ipv6> ipv6 = r->ipv6;
+    Ptr<Ipv6RoutingProtocol> root = ipv6->GetRoutingProtocol ();
+    Ptr<Ipv6ListRouting> list = DynamicCast<Ipv6ListRouting> (root);
+    uint32_t count = list ? list->GetNRoutingProtocols () : 1;
+    for (uint32_t i = 0; i < count; i++)
+      {
+        int16_t priority;
+        Ptr<Ipv6RoutingProtocol> protocol = list ? list->GetRoutingProtocol (i, priority) : root;
+        std::string name = Name (protocol);
+        Ptr<Ipv6StaticRouting> staticRouting = DynamicCast<Ipv6StaticRouting> (protocol);
+        if (staticRouting)
+          {
+            Table table;
+            for (uint32_t k = 0; k < staticRouting->GetNRoutes (); k++)
+              {
+                Ipv6RoutingTableEntry route = staticRouting->GetRoute (k);
+                Add (table, name, route.GetDest (), route.GetDestNetworkPrefix ().GetPrefixLength (),
+                     route.GetGateway (), route.GetInterface (), staticRouting->GetMetric (k));
+              }
+            Replace (r, name, table);
+          }
+        else
+          {
+            Socket::SocketErrno err;
+            for (std::set<std::pair<Ipv6Address, uint32_t> >::const_iterator s = r->dirty6.begin ();
+                 s != r->dirty6.end (); ++s)
+              {
+                Ipv6Header header;
+                header.SetDestinationAddress (s->first);
+                Ptr<Ipv6Route> route = protocol->RouteOutput (Create<Packet> (), header, 0, err);
+                Entry e;
+                if (route)
+                  {
+                    e = MakeEntry (route->GetGateway (), ipv6->GetInterfaceForDevice (route->GetOutputDevice ()), -1);
+                  }
+                Update (r, Key (name, s->first, s->second), route ? &e : 0);
+              }
+          }
+      }
+  }
+
+  /* Troca as rotas de um protocolo lido inteiro pelas de table. */
+  void Replace (Ptr<Router> r, const std::string &protocol, const Table &table)
+  {
+    std::string prefix = protocol + " ";
+    std::vector<std::string> gone;
+    for (Table::const_iterator e = r->table.lower_bound (prefix);
+         e != r->table.end () && e->first.compare (0, prefix.size (), prefix) == 0; ++e)
+      {
+        if (table.find (e->first) == table.end ())
+          {
+            gone.push_back (e->first);
+          }
+      }
+    for (uint32_t k = 0; k < gone.size (); k++)
+      {
+        Update (r, gone[k], 0);
+      }
+    for (Table::const_iterator e = table.begin (); e != table.end (); ++e)
+      {
+        Update (r, e->first, &e->second);
+      }
+  }
+
+  /* Compara uma chave com a copia do no; after nulo e rota ausente. */
+  void Update (Ptr<Router> r, const std::string &key, const Entry *after)
+  {
+    Table::iterator before = r->table.find (key);
+    if (before == r->table.end () ? !after : (after && before->second == *after))
+      {
+        return;
+      }
+    if (m_os)
+      {
+        *m_os << "Route " << Simulator::Now ().GetSeconds () << "s " << Names::FindName (r->node) << " "
+              << (before == r->table.end () ? "add" : after ? "mod" : "del") << " ";
+        if (before != r->table.end ())
+          {
+            Write (*m_os, key, before->second);
+          }
+        if (before != r->table.end () && after)
+          {
+            *m_os << " -> ";
+          }
+        if (after)
+          {
+            Write (*m_os, key, *after);
+          }
+        *m_os << std::endl;
+      }
+    if (before == r->table.end ())
+      {
+        r->added++;
+        r->table[key] = *after;
+      }
+    else if (!after)
+      {
+        r->removed++;
+        r->table.erase (before);
+      }
+    else
+      {
+        r->modified++;
+        before->second = *after;
+      }
+    r->lastChange = Simulator::Now ();
+  }
+
+  void Check (uint32_t index)
+  {
+    Ptr<Router> r = m_routers[index];
+    r->pending = false;
+    if (!r->probed)
+      {
+        // Primeira comparacao: todas as sub-redes da topologia
+        if (!m_subnetsRead)
+          {
+            Subnets ();
+          }
+        r->dirty.insert (m_subnets.begin (), m_subnets.end ());
+        r->dirty6.insert (m_subnets6.begin (), m_subnets6.end ());
+        r->probed = true;
+      }
+    if (r->ipv4 && r->ipv4->GetRoutingProtocol ())
+      {
+        Snapshot (r);
+      }
+    else if (r->ipv6 && r->ipv6->GetRoutingProtocol ())
+      {
+        Snapshot6 (r);
+      }
+    r->dirty.clear ();
+    r->dirty6.clear ();
+  }
+
+  std::ostream *m_os;
+  Time m_window;
+  bool m_subnetsRead;
+  std::vector<Ptr<Router> > m_routers;
+  std::vector<std::pair<uint32_t, uint32_t> > m_subnets;
+  std::vector<std::pair<Ipv6Address, uint32_t> > m_subnets6;
+};
+
+} // namespace ns3
+
+#endif /* ROUTE_CHANGES_H */
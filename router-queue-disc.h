@@ -0,0 +1,98 @@
+#ifndef ROUTER_QUEUE_DISC_H
+#define ROUTER_QUEUE_DISC_H
+
+#include <ostream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+namespace ns3 {
+
+/*
+ * Gerencia ativa de fila nas interfaces dos roteadores.
+ *
+ * Tipos aceitos: PfifoFast (padrao do ns-3), RED, CoDel e FqCoDel.
+ * Install deve ser chamado depois do InternetStackHelper e ANTES do
+ * Ipv4AddressHelper::Assign; caso contrario o Assign ja instalou a
+ * pfifo_fast padrao no device.
+ */
+class RouterQueueDiscs
+{
+public:
+  void Install (std::string type, NodeContainer routers)
+  {
+    m_type = type;
+    for (NodeContainer::Iterator n = routers.Begin (); n != routers.End (); ++n)
+      {
+        for (uint32_t i = 0; i < (*n)->GetNDevices (); i++)
+          {
+            Ptr<NetDevice> dev = (*n)->GetDevice (i);
+            if (!DynamicCast<CsmaNetDevice> (dev) && !DynamicCast<PointToPointNetDevice> (dev))
+              {
+                continue;
+              }
+            TrafficControlHelper tch;
+            if (type == "PfifoFast")
+              {
+                tch.SetRootQueueDisc ("ns3::PfifoFastQueueDisc");
+              }
+            else if (type == "RED")
+              {
+                // RED precisa conhecer a capacidade do enlace para o idle time
+                tch.SetRootQueueDisc ("ns3::RedQueueDisc",
+                                      "LinkBandwidth", DataRateValue (GetLinkRate (dev)));
+              }
+            else if (type == "CoDel")
+              {
+                tch.SetRootQueueDisc ("ns3::CoDelQueueDisc");
+              }
+            else if (type == "FqCoDel")
+              {
+                tch.SetRootQueueDisc ("ns3::FqCoDelQueueDisc");
+              }
+            else
+              {
+                NS_ABORT_MSG ("Unknown queue disc " << type << " (PfifoFast, RED, CoDel, FqCoDel)");
+              }
+            m_devices.Add (dev);
+            m_queueDiscs.Add (tch.Install (dev));
+          }
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Queue disc " << m_type << " statistics" << std::endl;
+    for (uint32_t i = 0; i < m_queueDiscs.GetN (); i++)
+      {
+        Ptr<NetDevice> dev = m_devices.Get (i);
+        os << "  " << Names::FindName (dev->GetNode ()) << "/" << dev->GetIfIndex ()
+           << std::endl << m_queueDiscs.Get (i)->GetStats () << std::endl;
+      }
+  }
+
+private:
+  static DataRate GetLinkRate (Ptr<NetDevice> dev)
+  {
+    Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel> (dev->GetChannel ());
+    if (channel)
+      {
+        return channel->GetDataRate ();
+      }
+    DataRateValue rate;
+    dev->GetAttribute ("DataRate", rate);
+    return rate.Get ();
+  }
+
+  std::string m_type;
+  NetDeviceContainer m_devices;
+  QueueDiscContainer m_queueDiscs;
+};
+
+} // namespace ns3
+
+#endif /* ROUTER_QUEUE_DISC_H */
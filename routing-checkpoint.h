@@ -0,0 +1,341 @@
+#ifndef ROUTING_CHECKPOINT_H
+#define ROUTING_CHECKPOINT_H
+
+#include <fstream>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+
+namespace ns3 {
+
+/*
+ * Checkpoint do estado convergido do roteamento.
+ *
+ * SaveRoutingCheckpoint grava, para cada roteador, a tabela de encaminhamento
+ * efetiva (o que RouteOutput responde para cada sub-rede da topologia, seja RIP
+ * ou OLSR) e as entradas ARP vivas de todos os nos:
+ *
+ *   checkpoint <tempo>
+ *   route <no> <rede> <mascara> <gateway> <interface>
+ *   arp <no> <interface> <ip> <mac>
+ *
+ * RoutingCheckpoint::Load reinstala as rotas numa Ipv4StaticRouting de
+ * prioridade menor que o protocolo dinamico e repopula os caches ARP. O
+ * protocolo continua partindo do zero (os timers do RIP/OLSR nao sao
+ * serializaveis no ns-3), mas o encaminhamento ja funciona desde t=0; as
+ * rotas restauradas saem conforme o protocolo reaprende cada rede.
+ */
+
+inline std::string
+CheckpointNodeName (Ptr<Node> node)
+{
+  std::string name = Names::FindName (node);
+  NS_ABORT_MSG_IF (name.empty (), "Checkpoint requires named nodes (node " << node->GetId () << ")");
+  return name;
+}
+
+inline void
+SaveRoutingCheckpoint (NodeContainer routers, std::string fileName)
+{
+  std::ofstream out (fileName.c_str ());
+  out << "checkpoint " << Simulator::Now ().GetSeconds () << std::endl;
+
+  // Todas as sub-redes conhecidas na topologia
+  std::set<std::pair<uint32_t, uint32_t> > subnets;
+  for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (n)->GetObject<Ipv4> ();
+      for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+        {
+          for (uint32_t j = 0; j < ipv4->GetNAddresses (i); j++)
+            {
+              Ipv4InterfaceAddress addr = ipv4->GetAddress (i, j);
+              subnets.insert (std::make_pair (addr.GetLocal ().CombineMask (addr.GetMask ()).Get (),
+                                              addr.GetMask ().Get ()));
+            }
+        }
+    }
+
+  for (NodeContainer::Iterator it = routers.Begin (); it != routers.End (); ++it)
+    {
+      Ptr<Ipv4> ipv4 = (*it)->GetObject<Ipv4> ();
+      for (std::set<std::pair<uint32_t, uint32_t> >::const_iterator s = subnets.begin (); s != subnets.end (); ++s)
+        {
+          Ipv4Header header;
+          header.SetDestination (Ipv4Address (s->first));
+          Socket::SocketErrno err;
+          Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol ()->RouteOutput (Create<Packet> (), header, 0, err);
+          if (!route || route->GetGateway () == Ipv4Address::GetAny ())
+            {
+              // Sem rota ou rede diretamente conectada
+              continue;
+            }
+          out << "route " << CheckpointNodeName (*it) << " " << Ipv4Address (s->first)
+              << " " << Ipv4Mask (s->second) << " " << route->GetGateway ()
+              << " " << ipv4->GetInterfaceForDevice (route->GetOutputDevice ()) << std::endl;
+        }
+    }
+
+  // Entradas ARP: vizinhos no mesmo canal de cada interface
+  for (uint32_t n = 0; n < NodeList::GetNNodes (); n++)
+    {
+      Ptr<Node> node = NodeList::GetNode (n);
+      Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+      for (uint32_t i = 1; ipv4 && i < ipv4->GetNInterfaces (); i++)
+        {
+          Ptr<ArpCache> cache = ipv4->GetInterface (i)->GetArpCache ();
+          Ptr<Channel> channel = ipv4->GetNetDevice (i)->GetChannel ();
+          for (uint32_t d = 0; cache && channel && d < channel->GetNDevices (); d++)
+            {
+              Ptr<NetDevice> peer = channel->GetDevice (d);
+              Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+              if (peer == ipv4->GetNetDevice (i) || !peerIpv4)
+                {
+                  continue;
+                }
+              int32_t peerIf = peerIpv4->GetInterfaceForDevice (peer);
+              if (peerIf < 0 || peerIpv4->GetNAddresses (peerIf) == 0)
+                {
+                  continue;
+                }
+              Ipv4Address peerAddr = peerIpv4->GetAddress (peerIf, 0).GetLocal ();
+              ArpCache::Entry *entry = cache->Lookup (peerAddr);
+              if (entry && entry->IsAlive ())
+                {
+                  out << "arp " << CheckpointNodeName (node) << " " << i << " " << peerAddr
+                      << " " << Mac48Address::ConvertFrom (entry->GetMacAddress ()) << std::endl;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Rotas e ARP restaurados de um checkpoint.
+ *
+ * As rotas entram na Ipv4StaticRouting abaixo do protocolo dinamico e sao
+ * provisorias: a cada 0.5 s cada uma e comparada com os protocolos
+ * dinamicos do no (RouteOutput para a rede) e sai assim que um deles tem
+ * rota propria para ela; as que sobram expiram depois de um intervalo de
+ * atualizacao do protocolo (UnsolicitedRoutingUpdate no RIP, TcInterval no
+ * OLSR). Sem isso a rota estatica, que nunca expira, assumia o trafego
+ * quando o RIP invalidava o destino e o fluxo seguia o caminho de antes da
+ * falha. As entradas ARP entram vivas, nao permanentes, e expiram como as
+ * aprendidas.
+ *
+ * Vies que continua: o protocolo parte do zero com a linha do tempo
+ * deslocada pelo instante do checkpoint, entao a falha cai poucos segundos
+ * depois da partida, com o RIP/OLSR possivelmente ainda convergindo. O
+ * resumo e o registro de resultado (secao checkpoint) dizem quantas rotas
+ * restauradas ainda estavam instaladas na falha; com valor diferente de zero
+ * a execucao nao equivale a uma aquecida.
+ */
+class RoutingCheckpoint
+{
+public:
+  RoutingCheckpoint ()
+    : m_time (0), m_restored (0), m_replaced (0), m_expired (0), m_leftAtFailure (-1)
+  {
+  }
+
+  /* Retorna o instante em que o checkpoint foi gravado. */
+  double Load (std::string fileName)
+  {
+    std::ifstream in (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (in, "Cannot open checkpoint " << fileName);
+    std::string kind;
+    while (in >> kind)
+      {
+        if (kind == "checkpoint")
+          {
+            in >> m_time;
+          }
+        else if (kind == "route")
+          {
+            std::string node, network, mask, gateway;
+            Restored r;
+            in >> node >> network >> mask >> gateway >> r.interface;
+            r.node = Names::Find<Node> (node);
+            r.network = Ipv4Address (network.c_str ());
+            r.mask = Ipv4Mask (mask.c_str ());
+            r.gateway = Ipv4Address (gateway.c_str ());
+            Ptr<Ipv4StaticRouting> staticRouting = StaticRouting (r.node);
+            NS_ABORT_MSG_UNLESS (staticRouting, "Node " << node << " has no static routing to restore into");
+            staticRouting->AddNetworkRouteTo (r.network, r.mask, r.gateway, r.interface);
+            m_routes.push_back (r);
+            m_restored++;
+          }
+        else if (kind == "arp")
+          {
+            std::string node, address, mac;
+            uint32_t interface;
+            in >> node >> interface >> address >> mac;
+            Ptr<Ipv4L3Protocol> ipv4 = Names::Find<Node> (node)->GetObject<Ipv4L3Protocol> ();
+            Ptr<ArpCache> cache = ipv4->GetInterface (interface)->GetArpCache ();
+            ArpCache::Entry *entry = cache->Add (Ipv4Address (address.c_str ()));
+            entry->SetMacAddress (Mac48Address (mac.c_str ()));
+          }
+        else
+          {
+            NS_ABORT_MSG ("Unknown checkpoint record " << kind);
+          }
+      }
+    Simulator::Schedule (Seconds (0.5), &RoutingCheckpoint::Release, this);
+    return m_time;
+  }
+
+  /* Conta as rotas restauradas ainda instaladas no instante da falha. */
+  void MarkFailure (Time failure)
+  {
+    Simulator::Schedule (failure, &RoutingCheckpoint::CountLeft, this);
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Checkpoint (" << m_time << "s): restored=" << m_restored << " replaced=" << m_replaced
+       << " expired=" << m_expired << " leftAtFailure=" << m_leftAtFailure;
+    if (m_leftAtFailure > 0)
+      {
+        os << " (biased: restored routes still forwarding at the failure)";
+      }
+    os << std::endl;
+  }
+
+  /* Para o registro de resultado (result-record.h). */
+  std::string ToJson (void) const
+  {
+    std::ostringstream os;
+    os << "{\"time_s\": " << m_time << ", \"restored\": " << m_restored << ", \"replaced\": " << m_replaced
+       << ", \"expired\": " << m_expired << ", \"left_at_failure\": " << m_leftAtFailure
+       << ", \"biased\": " << (m_leftAtFailure != 0 ? "true" : "false") << "}";
+    return os.str ();
+  }
+
+private:
+  struct Restored
+  {
+    Ptr<Node> node;
+    Ipv4Address network;
+    Ipv4Mask mask;
+    Ipv4Address gateway;
+    uint32_t interface;
+  };
+
+  static Ptr<Ipv4StaticRouting> StaticRouting (Ptr<Node> node)
+  {
+    return Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting> (node->GetObject<Ipv4> ()->GetRoutingProtocol ());
+  }
+
+  /* Protocolos do no fora a Ipv4StaticRouting. */
+  static std::vector<Ptr<Ipv4RoutingProtocol> > Dynamic (Ptr<Node> node)
+  {
+    std::vector<Ptr<Ipv4RoutingProtocol> > protocols;
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (node->GetObject<Ipv4> ()->GetRoutingProtocol ());
+    for (uint32_t i = 0; list && i < list->GetNRoutingProtocols (); i++)
+      {
+        int16_t priority;
+        Ptr<Ipv4RoutingProtocol> protocol = list->GetRoutingProtocol (i, priority);
+        if (!DynamicCast<Ipv4StaticRouting> (protocol))
+          {
+            protocols.push_back (protocol);
+          }
+      }
+    return protocols;
+  }
+
+  /* Um intervalo de atualizacao do protocolo dinamico do no. */
+  static Time MaxAge (Ptr<Node> node)
+  {
+    std::vector<Ptr<Ipv4RoutingProtocol> > protocols = Dynamic (node);
+    Time age;
+    for (uint32_t i = 0; i < protocols.size (); i++)
+      {
+        TimeValue interval;
+        TypeId::AttributeInformation info;
+        if (protocols[i]->GetInstanceTypeId ().LookupAttributeByName ("UnsolicitedRoutingUpdate", &info))
+          {
+            protocols[i]->GetAttribute ("UnsolicitedRoutingUpdate", interval);
+          }
+        else if (protocols[i]->GetInstanceTypeId ().LookupAttributeByName ("TcInterval", &info))
+          {
+            protocols[i]->GetAttribute ("TcInterval", interval);
+          }
+        age = Max (age, interval.Get ());
+      }
+    return age;
+  }
+
+  void Remove (const Restored &r)
+  {
+    Ptr<Ipv4StaticRouting> staticRouting = StaticRouting (r.node);
+    for (uint32_t i = 0; i < staticRouting->GetNRoutes (); i++)
+      {
+        Ipv4RoutingTableEntry e = staticRouting->GetRoute (i);
+        if (e.GetDestNetwork () == r.network && e.GetDestNetworkMask () == r.mask && e.GetGateway () == r.gateway
+            && e.GetInterface () == r.interface)
+          {
+            staticRouting->RemoveRoute (i);
+            return;
+          }
+      }
+  }
+
+  void Release (void)
+  {
+    Time now = Simulator::Now ();
+    std::vector<Restored> kept;
+    for (std::vector<Restored>::const_iterator r = m_routes.begin (); r != m_routes.end (); ++r)
+      {
+        Ipv4Header header;
+        header.SetDestination (r->network);
+        Socket::SocketErrno err;
+        bool learned = false;
+        std::vector<Ptr<Ipv4RoutingProtocol> > protocols = Dynamic (r->node);
+        for (uint32_t i = 0; i < protocols.size () && !learned; i++)
+          {
+            learned = protocols[i]->RouteOutput (Create<Packet> (), header, 0, err) != 0;
+          }
+        if (learned)
+          {
+            Remove (*r);
+            m_replaced++;
+          }
+        else if (now >= MaxAge (r->node))
+          {
+            Remove (*r);
+            m_expired++;
+          }
+        else
+          {
+            kept.push_back (*r);
+          }
+      }
+    m_routes.swap (kept);
+    if (!m_routes.empty ())
+      {
+        Simulator::Schedule (Seconds (0.5), &RoutingCheckpoint::Release, this);
+      }
+  }
+
+  void CountLeft (void)
+  {
+    m_leftAtFailure = m_routes.size ();
+  }
+
+  double m_time;
+  uint32_t m_restored;
+  uint32_t m_replaced;
+  uint32_t m_expired;
+  int64_t m_leftAtFailure;
+  std::vector<Restored> m_routes;
+};
+
+} // namespace ns3
+
+#endif /* ROUTING_CHECKPOINT_H */
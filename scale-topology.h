@@ -0,0 +1,104 @@
+#ifndef SCALE_TOPOLOGY_H
+#define SCALE_TOPOLOGY_H
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/constant-position-mobility-model.h"
+
+namespace ns3 {
+
+/*
+ * Variante escalada de um cenario: acrescenta uma grade de n roteadores
+ * (cada um ligado ao vizinho da direita e ao de baixo) pendurada em um
+ * roteador existente. Usado pelo benchmark para medir o mesmo cenario com
+ * 100, 1k e 10k roteadores.
+ *
+ * Deve ser chamado depois do enderecamento original, para nao alterar os
+ * indices de interface usados pelo TearDownLink. Os enlaces usam o mesmo
+ * helper (CSMA ou PointToPoint) e a mesma pilha (RIP ou OLSR) do cenario,
+ * com sub-redes /30 em 172.16.0.0/12. A pilha pode ser o InternetStackHelper
+ * do cenario ou o SlimStackHelper; sem positions os roteadores nao ganham
+ * modelo de mobilidade (so a animacao precisa dele).
+ *
+ * Com RIP a grade nao converge inteira quando GridDepth (n), os saltos do
+ * roteador de ligacao ate o mais distante, chega a 15 (grade cheia de lado
+ * 8, n = 64): a metrica 16 do RIP e infinito, entao os roteadores do fundo
+ * da grade ficam sem rota para a topologia original (e, em grades maiores,
+ * para parte da propria grade). O fluxo do cenario nao passa pela
+ * grade e nao e afetado; o benchmark mede o custo, nao a convergencia.
+ */
+/* Saltos do roteador de ligacao ate o roteador mais distante da grade de n. */
+inline uint32_t
+GridDepth (uint32_t n)
+{
+  uint32_t side = static_cast<uint32_t> (std::ceil (std::sqrt (static_cast<double> (n))));
+  uint32_t depth = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      depth = std::max (depth, i / side + i % side + 1);
+    }
+  return depth;
+}
+
+template <class LinkHelper, class StackHelper>
+NodeContainer
+BuildRouterGrid (uint32_t n, Ptr<Node> attach, LinkHelper &links, StackHelper &stack, bool positions = true)
+{
+  NodeContainer grid;
+  if (n == 0)
+    {
+      return grid;
+    }
+  grid.Create (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      std::ostringstream name;
+      name << "GridRouter" << i;
+      Names::Add (name.str (), grid.Get (i));
+    }
+  stack.Install (grid);
+
+  if (positions)
+    {
+      MobilityHelper mobility;
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobility.Install (grid);
+    }
+
+  uint32_t side = static_cast<uint32_t> (std::ceil (std::sqrt (static_cast<double> (n))));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase (Ipv4Address ("172.16.0.0"), Ipv4Mask ("255.255.255.252"));
+
+  ipv4.Assign (links.Install (NodeContainer (attach, grid.Get (0))));
+  ipv4.NewNetwork ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t row = i / side;
+      uint32_t col = i % side;
+      if (positions)
+        {
+          grid.Get (i)->GetObject<ConstantPositionMobilityModel> ()->SetPosition (Vector (100.0 + col * 5, row * 5, 0));
+        }
+      if (col + 1 < side && i + 1 < n)
+        {
+          ipv4.Assign (links.Install (NodeContainer (grid.Get (i), grid.Get (i + 1))));
+          ipv4.NewNetwork ();
+        }
+      if (i + side < n)
+        {
+          ipv4.Assign (links.Install (NodeContainer (grid.Get (i), grid.Get (i + side))));
+          ipv4.NewNetwork ();
+        }
+    }
+  return grid;
+}
+
+} // namespace ns3
+
+#endif /* SCALE_TOPOLOGY_H */
@@ -0,0 +1,417 @@
+#ifndef SLIM_STACK_H
+#define SLIM_STACK_H
+
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/olsr-routing-protocol.h"
+#include "ns3/constant-position-mobility-model.h"
+
+namespace ns3 {
+
+/*
+ * Pilha reduzida para roteadores de transito: so o que o encaminhamento e o
+ * roteamento usam (IPv4, ARP, ICMP, camada de trafego e UDP para RIP/OLSR).
+ * Em relacao ao InternetStackHelper fica de fora o TCP, a fabrica de
+ * PacketSocket e a pilha IPv6. Mesma interface SetRoutingHelper/Install,
+ * entao serve ao BuildRouterGrid.
+ */
+class SlimStackHelper
+{
+public:
+  SlimStackHelper ()
+    : m_routing (0)
+  {
+  }
+
+  ~SlimStackHelper ()
+  {
+    delete m_routing;
+  }
+
+  void SetRoutingHelper (const Ipv4RoutingHelper &routing)
+  {
+    delete m_routing;
+    m_routing = routing.Copy ();
+  }
+
+  void Install (NodeContainer nodes)
+  {
+    NS_ABORT_MSG_UNLESS (m_routing, "SlimStackHelper needs a routing helper");
+    for (NodeContainer::Iterator n = nodes.Begin (); n != nodes.End (); ++n)
+      {
+        NS_ABORT_MSG_IF ((*n)->GetObject<Ipv4> (), "Node " << (*n)->GetId () << " already has an IPv4 stack");
+        Aggregate (*n, "ns3::ArpL3Protocol");
+        Aggregate (*n, "ns3::Ipv4L3Protocol");
+        Aggregate (*n, "ns3::Icmpv4L4Protocol");
+        (*n)->GetObject<Ipv4> ()->SetRoutingProtocol (m_routing->Create (*n));
+        Aggregate (*n, "ns3::TrafficControlLayer");
+        Aggregate (*n, "ns3::UdpL4Protocol");
+      }
+  }
+
+private:
+  SlimStackHelper (const SlimStackHelper &);
+  SlimStackHelper &operator= (const SlimStackHelper &);
+
+  static void Aggregate (Ptr<Node> node, std::string typeId)
+  {
+    ObjectFactory factory;
+    factory.SetTypeId (typeId);
+    node->AggregateObject (factory.Create<Object> ());
+  }
+
+  Ipv4RoutingHelper *m_routing;
+};
+
+/* Memoria residente do processo, em bytes (0 fora do Linux). */
+inline uint64_t
+ResidentBytes (void)
+{
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  std::FILE *statm = std::fopen ("/proc/self/statm", "r");
+  if (!statm)
+    {
+      return 0;
+    }
+  if (std::fscanf (statm, "%lu %lu", &size, &resident) != 2)
+    {
+      resident = 0;
+    }
+  std::fclose (statm);
+  return static_cast<uint64_t> (resident) * sysconf (_SC_PAGESIZE);
+}
+
+/*
+ * Contabilidade de memoria por no e por componente (no, devices, ipv4, arp,
+ * icmp, udp, tcp, ipv6, tc, routing, mobility, other), por grupo de nos.
+ *
+ * E uma estimativa feita no fim da execucao: sizeof de cada objeto agregado
+ * ao no, dos devices e filas, das interfaces IPv4 e caches ARP (com as
+ * entradas) e dos protocolos de roteamento com as entradas da tabela de
+ * rotas. Pacotes em fila, sockets e o estado de topologia do OLSR (que nao
+ * e exposto) ficam de fora. Para um grupo construido entre MarkStart e
+ * MarkEnd tambem sai o crescimento medido da memoria residente, que inclui
+ * tudo isso.
+ */
+class MemoryAccounting
+{
+public:
+  MemoryAccounting ()
+    : m_rssStart (0)
+  {
+  }
+
+  void MarkStart (void)
+  {
+    m_rssStart = ResidentBytes ();
+  }
+
+  void MarkEnd (std::string group)
+  {
+    uint64_t rss = ResidentBytes ();
+    m_rss[group] = rss > m_rssStart ? rss - m_rssStart : 0;
+  }
+
+  void AddGroup (std::string group, NodeContainer nodes)
+  {
+    if (nodes.GetN ())
+      {
+        m_groups.push_back (std::make_pair (group, nodes));
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    os << "Memory per node (estimated from object sizes)" << std::endl;
+    for (std::vector<std::pair<std::string, NodeContainer> >::const_iterator g = m_groups.begin ();
+         g != m_groups.end (); ++g)
+      {
+        Footprint sum;
+        Ptr<Node> largest;
+        uint64_t largestBytes = 0;
+        std::vector<std::pair<Ptr<Node>, Footprint> > perNode;
+        for (NodeContainer::Iterator n = g->second.Begin (); n != g->second.End (); ++n)
+          {
+            Footprint f = Account (*n);
+            uint64_t bytes = Total (f);
+            for (Footprint::const_iterator c = f.begin (); c != f.end (); ++c)
+              {
+                sum[c->first] += c->second;
+              }
+            if (bytes > largestBytes)
+              {
+                largest = *n;
+                largestBytes = bytes;
+              }
+            if (g->second.GetN () <= 16)
+              {
+                perNode.push_back (std::make_pair (*n, f));
+              }
+          }
+        uint32_t nodes = g->second.GetN ();
+        os << "  " << g->first << ": " << nodes << " nodes, " << Total (sum) / nodes << " B/node";
+        PrintComponents (os, sum, nodes);
+        os << std::endl;
+        os << "    largest " << Names::FindName (largest) << " " << largestBytes << " B";
+        std::map<std::string, uint64_t>::const_iterator rss = m_rss.find (g->first);
+        if (rss != m_rss.end ())
+          {
+            os << ", build RSS " << rss->second / 1024 << " kB (" << rss->second / nodes << " B/node)";
+          }
+        os << std::endl;
+        for (std::vector<std::pair<Ptr<Node>, Footprint> >::const_iterator it = perNode.begin ();
+             it != perNode.end (); ++it)
+          {
+            os << "    " << Names::FindName (it->first) << " " << Total (it->second) << " B";
+            PrintComponents (os, it->second, 1);
+            os << std::endl;
+          }
+      }
+  }
+
+private:
+  typedef std::map<std::string, uint64_t> Footprint;
+
+  static uint64_t Total (const Footprint &f)
+  {
+    uint64_t total = 0;
+    for (Footprint::const_iterator c = f.begin (); c != f.end (); ++c)
+      {
+        total += c->second;
+      }
+    return total;
+  }
+
+  static void PrintComponents (std::ostream &os, const Footprint &f, uint32_t nodes)
+  {
+    static const char *order[] = { "node", "devices", "ipv4", "arp", "icmp", "udp", "tcp", "ipv6", "tc",
+                                   "routing", "mobility", "other" };
+    for (uint32_t k = 0; k < sizeof (order) / sizeof (order[0]); k++)
+      {
+        Footprint::const_iterator c = f.find (order[k]);
+        if (c != f.end () && c->second)
+          {
+            os << " " << order[k] << "=" << c->second / nodes;
+          }
+      }
+  }
+
+  static std::string Component (std::string name)
+  {
+    if (name == "ns3::Node")
+      {
+        return "node";
+      }
+    if (name == "ns3::Ipv4L3Protocol")
+      {
+        return "ipv4";
+      }
+    if (name == "ns3::ArpL3Protocol")
+      {
+        return "arp";
+      }
+    if (name == "ns3::Icmpv4L4Protocol")
+      {
+        return "icmp";
+      }
+    if (name == "ns3::UdpL4Protocol")
+      {
+        return "udp";
+      }
+    if (name == "ns3::TcpL4Protocol")
+      {
+        return "tcp";
+      }
+    if (name == "ns3::TrafficControlLayer")
+      {
+        return "tc";
+      }
+    if (name.find ("Ipv6") != std::string::npos || name.find ("Icmpv6") != std::string::npos)
+      {
+        return "ipv6";
+      }
+    if (name.find ("Mobility") != std::string::npos)
+      {
+        return "mobility";
+      }
+    return "other";
+  }
+
+  static uint64_t ObjectSize (Ptr<const Object> object)
+  {
+    if (DynamicCast<const Node> (object))
+      {
+        return sizeof (Node);
+      }
+    if (DynamicCast<const Ipv4L3Protocol> (object))
+      {
+        return sizeof (Ipv4L3Protocol);
+      }
+    if (DynamicCast<const ArpL3Protocol> (object))
+      {
+        return sizeof (ArpL3Protocol);
+      }
+    if (DynamicCast<const Icmpv4L4Protocol> (object))
+      {
+        return sizeof (Icmpv4L4Protocol);
+      }
+    if (DynamicCast<const UdpL4Protocol> (object))
+      {
+        return sizeof (UdpL4Protocol);
+      }
+    if (DynamicCast<const TcpL4Protocol> (object))
+      {
+        return sizeof (TcpL4Protocol);
+      }
+    if (DynamicCast<const Ipv6L3Protocol> (object))
+      {
+        return sizeof (Ipv6L3Protocol);
+      }
+    if (DynamicCast<const Icmpv6L4Protocol> (object))
+      {
+        return sizeof (Icmpv6L4Protocol);
+      }
+    if (DynamicCast<const TrafficControlLayer> (object))
+      {
+        return sizeof (TrafficControlLayer);
+      }
+    if (DynamicCast<const ConstantPositionMobilityModel> (object))
+      {
+        return sizeof (ConstantPositionMobilityModel);
+      }
+    return sizeof (Object);
+  }
+
+  /* Linhas de uma tabela impressa que comecam com um endereco. */
+  static uint32_t CountEntries (std::string table)
+  {
+    std::istringstream in (table);
+    std::string line;
+    uint32_t entries = 0;
+    while (std::getline (in, line))
+      {
+        if (!line.empty () && line[0] >= '0' && line[0] <= '9')
+          {
+            entries++;
+          }
+      }
+    return entries;
+  }
+
+  static uint64_t RoutingSize (Ptr<Ipv4RoutingProtocol> routing)
+  {
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (routing);
+    Ptr<Rip> rip = DynamicCast<Rip> (routing);
+    Ptr<olsr::RoutingProtocol> olsr = DynamicCast<olsr::RoutingProtocol> (routing);
+    Ptr<Ipv4StaticRouting> staticRouting = DynamicCast<Ipv4StaticRouting> (routing);
+    // Entradas de std::list/std::map: dois ou quatro ponteiros por no
+    if (list)
+      {
+        uint64_t bytes = sizeof (Ipv4ListRouting);
+        for (uint32_t i = 0; i < list->GetNRoutingProtocols (); i++)
+          {
+            int16_t priority;
+            bytes += RoutingSize (list->GetRoutingProtocol (i, priority));
+          }
+        return bytes;
+      }
+    if (rip)
+      {
+        std::ostringstream table;
+        rip->PrintRoutingTable (Create<OutputStreamWrapper> (&table));
+        return sizeof (Rip)
+               + CountEntries (table.str ()) * (sizeof (RipRoutingTableEntry) + sizeof (EventId) + 2 * sizeof (void *));
+      }
+    if (olsr)
+      {
+        return sizeof (olsr::RoutingProtocol)
+               + olsr->GetRoutingTableEntries ().size () * (sizeof (olsr::RoutingTableEntry) + 4 * sizeof (void *));
+      }
+    if (staticRouting)
+      {
+        return sizeof (Ipv4StaticRouting)
+               + staticRouting->GetNRoutes () * (sizeof (Ipv4RoutingTableEntry) + 2 * sizeof (void *));
+      }
+    return sizeof (Ipv4RoutingProtocol);
+  }
+
+  static Footprint Account (Ptr<Node> node)
+  {
+    Footprint f;
+    Object::AggregateIterator it = node->GetAggregateIterator ();
+    while (it.HasNext ())
+      {
+        Ptr<const Object> object = it.Next ();
+        f[Component (object->GetInstanceTypeId ().GetName ())] += ObjectSize (object);
+      }
+
+    Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer> ();
+    for (uint32_t i = 0; i < node->GetNDevices (); i++)
+      {
+        Ptr<NetDevice> dev = node->GetDevice (i);
+        if (DynamicCast<CsmaNetDevice> (dev))
+          {
+            f["devices"] += sizeof (CsmaNetDevice) + sizeof (DropTailQueue<Packet>)
+                            + sizeof (CsmaChannel) / dev->GetChannel ()->GetNDevices ();
+          }
+        else if (DynamicCast<PointToPointNetDevice> (dev))
+          {
+            f["devices"] += sizeof (PointToPointNetDevice) + sizeof (DropTailQueue<Packet>)
+                            + sizeof (PointToPointChannel) / 2;
+          }
+        else
+          {
+            f["devices"] += sizeof (LoopbackNetDevice);
+          }
+        Ptr<QueueDisc> disc;
+        if (tc)
+          {
+            disc = tc->GetRootQueueDiscOnDevice (dev);
+          }
+        if (disc)
+          {
+            f["tc"] += sizeof (QueueDisc) + disc->GetNInternalQueues () * sizeof (DropTailQueue<QueueDiscItem>);
+          }
+      }
+
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+    for (uint32_t i = 0; ipv4 && i < ipv4->GetNInterfaces (); i++)
+      {
+        f["ipv4"] += sizeof (Ipv4Interface) + ipv4->GetNAddresses (i) * sizeof (Ipv4InterfaceAddress);
+        Ptr<ArpCache> cache = ipv4->GetInterface (i)->GetArpCache ();
+        if (cache)
+          {
+            std::ostringstream table;
+            cache->PrintArpCache (Create<OutputStreamWrapper> (&table));
+            f["arp"] += sizeof (ArpCache) + CountEntries (table.str ()) * (sizeof (ArpCache::Entry) + 4 * sizeof (void *));
+          }
+      }
+    if (ipv4 && ipv4->GetRoutingProtocol ())
+      {
+        f["routing"] += RoutingSize (ipv4->GetRoutingProtocol ());
+      }
+    return f;
+  }
+
+  uint64_t m_rssStart;
+  std::map<std::string, uint64_t> m_rss;
+  std::vector<std::pair<std::string, NodeContainer> > m_groups;
+};
+
+} // namespace ns3
+
+#endif /* SLIM_STACK_H */
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+Converte para texto o log binario gravado com --verbose (event-log.h).
+
+  python3 tools/event-log-decode.py topologia-ii-rip-events.bin
+  python3 tools/event-log-decode.py --component Rip --node 2,3 --start 38 --stop 60 arquivo.bin
+
+Os filtros aqui se somam aos aplicados durante a simulacao.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+
+RECORD = struct.Struct("<qIHHIII")
+COMPONENTS = ["Scenario", "Ipv4", "Rip", "Olsr", "Arp", "Queue"]
+EVENTS = {
+    "Scenario": {1: "LINK_DOWN", 2: "LINK_UP"},
+    "default": {1: "TX", 2: "RX", 3: "DROP", 4: "TABLE_CHANGED"},
+}
+IPV4_DROP_REASONS = {1: "TTL_EXPIRED", 2: "NO_ROUTE", 3: "BAD_CHECKSUM",
+                     4: "INTERFACE_DOWN", 5: "ROUTE_ERROR", 6: "FRAGMENT_TIMEOUT"}
+
+
+def ip(value):
+    return socket.inet_ntoa(struct.pack("!I", value))
+
+
+def describe(component, event, a, b, c):
+    if component == "Scenario":
+        return "peer=%d if=%d peerIf=%d" % (a, b, c)
+    if component == "Ipv4":
+        if event == "DROP":
+            return "%s -> %s reason=%s" % (ip(a), ip(b), IPV4_DROP_REASONS.get(c, c))
+        return "%s -> %s size=%d" % (ip(a), ip(b), c)
+    if component == "Rip":
+        return "peer=%s size=%d if=%d" % (ip(a), b, c)
+    if component == "Olsr":
+        if event == "TABLE_CHANGED":
+            return "routes=%d" % a
+        return "origin=%s messages=%d seq=%d" % (ip(a), b, c)
+    return "size=%d if=%d" % (a, b)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file")
+    parser.add_argument("--component", help="comma separated components (%s)" % ",".join(COMPONENTS))
+    parser.add_argument("--node", help="comma separated node ids")
+    parser.add_argument("--start", type=float, default=0.0, help="start of the time window (s)")
+    parser.add_argument("--stop", type=float, help="end of the time window (s)")
+    args = parser.parse_args()
+
+    components = set(args.component.split(",")) if args.component else None
+    nodes = set(int(n) for n in args.node.split(",")) if args.node else None
+
+    with open(args.file, "rb") as f:
+        magic, version = struct.unpack("<4sI", f.read(8))
+        if magic != b"EVLG" or version != 1:
+            sys.exit("%s: not an event log (version 1)" % args.file)
+        out = sys.stdout
+        while True:
+            data = f.read(RECORD.size)
+            if len(data) < RECORD.size:
+                break
+            ns, node, comp, ev, a, b, c = RECORD.unpack(data)
+            t = ns / 1e9
+            name = COMPONENTS[comp] if comp < len(COMPONENTS) else str(comp)
+            if components and name not in components:
+                continue
+            if nodes and node not in nodes:
+                continue
+            if t < args.start or (args.stop is not None and t > args.stop):
+                continue
+            event = EVENTS.get(name, EVENTS["default"]).get(ev, str(ev))
+            out.write("%.9f node=%d %s %s %s\n" % (t, node, name, event, describe(name, event, a, b, c)))
+
+
+if __name__ == "__main__":
+    main()
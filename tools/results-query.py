@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Consulta os registros de resultado gravados com --results=<arquivo>
+(result-record.h), uma linha JSON por execucao.
+
+Sem opcoes, agrupa as replicas de cada configuracao (mesmo cenario e mesmos
+parametros, qualquer seed/run) e mostra media e intervalo de confianca de
+95% de cada metrica:
+
+  python3 tools/results-query.py results.jsonl
+  python3 tools/results-query.py results.jsonl --where scenario=topologia-i-rip --where queueDisc=RED
+  python3 tools/results-query.py results.jsonl --group-by scenario,failure --metrics outage.recovery_s,perf.wall_s
+  python3 tools/results-query.py results.jsonl --list
+
+As metricas sao caminhos no registro achatado: outage.recovery_s,
+outage.gap_s, perf.wall_s, perf.peak_rss_kb, perf.events, as secoes
+opcionais (forwarding.loops, forwarding.loop_wasted_bytes...) e, para os fluxos,
+flow<N>.<campo> (flow1.loss_pct, flow1.throughput_kbps...). Parametros da
+linha de comando aparecem pelo nome, sem prefixo. Valores negativos (fluxo
+que nao voltou depois da falha) ficam fora das medias; quantas execucoes
+ficaram fora aparece ao lado, "12.3 +-0.5 (2 excl)", e so "- (N excl)"
+quando nenhuma voltou.
+
+Com --sql a consulta roda em SQLite sobre a tabela runs (uma coluna por
+campo achatado, pontos trocados por _); --sqlite grava esse banco em disco.
+
+  python3 tools/results-query.py results.jsonl --sql "SELECT failure, AVG(outage_recovery_s) FROM runs GROUP BY failure"
+"""
+
+import argparse
+import json
+import math
+import sqlite3
+import sys
+
+DEFAULT_METRICS = ["outage.recovery_s", "outage.gap_s", "flow1.loss_pct",
+                   "flow1.throughput_kbps", "perf.wall_s", "perf.peak_rss_kb"]
+# t de Student (95%, bilateral) para poucos graus de liberdade
+T95 = {1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+       8: 2.306, 9: 2.262, 10: 2.228, 15: 2.131, 20: 2.086, 30: 2.042}
+
+
+def flatten(record):
+    row = {}
+    for name in ("key", "scenario", "config", "seed", "run"):
+        row[name] = record.get(name)
+    for name, value in record.get("params", {}).items():
+        if name not in row:
+            row[name] = value
+    for section, values in record.items():
+        if section != "params" and isinstance(values, dict):
+            for name, value in values.items():
+                row["%s.%s" % (section, name)] = value
+    for index, flow in enumerate(record.get("flows", []), 1):
+        for name, value in flow.items():
+            row["flow%d.%s" % (index, name)] = value
+    return row
+
+
+def load(path):
+    rows = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                rows.append(flatten(json.loads(line)))
+            except ValueError:
+                sys.stderr.write("%s:%d: skipping malformed record\n" % (path, number))
+    return rows
+
+
+def matches(row, conditions):
+    for name, value in conditions:
+        if str(row.get(name)) != value:
+            return False
+    return True
+
+
+def t95(dof):
+    best = None
+    for k in sorted(T95):
+        if k <= dof:
+            best = T95[k]
+    return best if dof <= 30 else 1.96
+
+
+def summary(values):
+    numbers = [v for v in values if isinstance(v, (int, float)) and not isinstance(v, bool)]
+    values = [v for v in numbers if v >= 0]
+    excluded = " (%d excl)" % (len(numbers) - len(values)) if len(values) < len(numbers) else ""
+    if not values:
+        return "-" + excluded
+    mean = sum(values) / len(values)
+    if len(values) < 2:
+        return "%.6g%s" % (mean, excluded)
+    var = sum((v - mean) ** 2 for v in values) / (len(values) - 1)
+    return "%.6g +-%.3g%s" % (mean, t95(len(values) - 1) * math.sqrt(var / len(values)), excluded)
+
+
+def run_sql(rows, query, database):
+    columns = []
+    for row in rows:
+        for name in row:
+            if name not in columns:
+                columns.append(name)
+    conn = sqlite3.connect(database)
+    sql_names = [c.replace(".", "_") for c in columns]
+    conn.execute("DROP TABLE IF EXISTS runs")
+    conn.execute("CREATE TABLE runs (%s)" % ", ".join('"%s"' % c for c in sql_names))
+    conn.executemany("INSERT INTO runs VALUES (%s)" % ", ".join("?" * len(columns)),
+                     [[row.get(c) for c in columns] for row in rows])
+    conn.commit()
+    cursor = conn.execute(query)
+    print("\t".join(d[0] for d in cursor.description))
+    for result in cursor:
+        print("\t".join("" if v is None else str(v) for v in result))
+    conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file")
+    parser.add_argument("--where", action="append", default=[],
+                        help="name=value filter on a field or parameter (repeatable)")
+    parser.add_argument("--group-by", default="scenario,config",
+                        help="comma separated fields replicas are grouped by")
+    parser.add_argument("--metrics", help="comma separated metrics (default %s)" % ",".join(DEFAULT_METRICS))
+    parser.add_argument("--list", action="store_true", help="print one line per run instead of groups")
+    parser.add_argument("--sql", help="SQL query over the runs table")
+    parser.add_argument("--sqlite", default=":memory:", help="SQLite database file used by --sql")
+    args = parser.parse_args()
+
+    conditions = []
+    for condition in args.where:
+        if "=" not in condition:
+            sys.exit("--where expects name=value, got %s" % condition)
+        conditions.append(tuple(condition.split("=", 1)))
+    rows = [row for row in load(args.file) if matches(row, conditions)]
+
+    if args.sql:
+        run_sql(rows, args.sql, args.sqlite)
+        return
+    metrics = args.metrics.split(",") if args.metrics else DEFAULT_METRICS
+    if args.list:
+        print("\t".join(["key"] + metrics))
+        for row in rows:
+            print("\t".join([row["key"]] + [str(row.get(m, "-")) for m in metrics]))
+        return
+
+    fields = args.group_by.split(",")
+    groups = {}
+    for row in rows:
+        groups.setdefault(tuple(str(row.get(f)) for f in fields), []).append(row)
+    print("\t".join(fields + ["runs"] + metrics))
+    for key in sorted(groups):
+        group = groups[key]
+        print("\t".join(list(key) + [str(len(group))] + [summary([r.get(m) for r in group]) for m in metrics]))
+
+
+if __name__ == "__main__":
+    main()
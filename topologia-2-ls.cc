@@ -19,6 +19,28 @@
 #include "ns3/netanim-module.h"
 #include "ns3/constant-position-mobility-model.h"
 #include "ns3/mobility-helper.h"
+#include "queue-monitor.h"
+#include "router-queue-disc.h"
+#include "flow-report.h"
+#include "routing-checkpoint.h"
+#include "fluid-background.h"
+#include "scale-topology.h"
+#include "event-log.h"
+#include "fast-reroute.h"
+#include "bfd.h"
+#include "pcap-capture.h"
+#include "medium.h"
+#include "arp-tuning.h"
+#include "metrics.h"
+#include "slim-stack.h"
+#include "result-record.h"
+#include "route-changes.h"
+#include "path-tracer.h"
+#include "forwarding-monitor.h"
+#include "early-stop.h"
+#include "traffic-matrix.h"
+#include "ecmp-routing.h"
+#include "link-utilisation.h"
 
 using namespace ns3;
 
@@ -26,10 +48,22 @@ NS_LOG_COMPONENT_DEFINE ("Topologia2");
 Address serverAddress;
 
 //Metodo para derrubar links
-void TearDownLink (Ptr<Node> nodeA, Ptr<Node> nodeB, uint32_t interfaceA, uint32_t interfaceB)
+void TearDownLink (Ptr<Node> nodeA, Ptr<Node> nodeB, std::string failure, int64_t stream)
 {
-  nodeA->GetObject<Ipv4> ()->SetDown (interfaceA);
-  nodeB->GetObject<Ipv4> ()->SetDown (interfaceB);
+  // Interfaces do enlace entre os dois nos, o mesmo que o CutLink corta
+  std::pair<uint32_t, uint32_t> interfaces = SharedLinkInterfaces (nodeA, nodeB);
+  uint32_t interfaceA = interfaces.first;
+  uint32_t interfaceB = interfaces.second;
+  if (failure != "admin")
+    {
+      CutLink (nodeA, nodeB, failure == "oneway", stream);
+    }
+  else
+    {
+      nodeA->GetObject<Ipv4> ()->SetDown (interfaceA);
+      nodeB->GetObject<Ipv4> ()->SetDown (interfaceB);
+    }
+  EVENT_LOG (1, EventLog::SCENARIO, nodeA->GetId (), EventLog::LINK_DOWN, nodeB->GetId (), interfaceA, interfaceB);
 }
 
 int main (int argc, char **argv)
@@ -37,22 +71,183 @@ int main (int argc, char **argv)
   bool verbose = false;
   bool printRoutingTables = false;
   bool showPings = false;
+  bool queueStats = false;
+  double queueStatsInterval = 0.1;
+  std::string queueDisc ("PfifoFast");
+  bool flowStats = false;
+  uint32_t seed = 1;
+  uint64_t run = 1;
+  double startJitter = 0.0;
+  double failureJitter = 0.0;
+  std::string checkpointSave;
+  double checkpointTime = 35.0;
+  std::string checkpointLoad;
+  std::string fluidDemands;
+  double fluidInterval = 1.0;
+  uint32_t scale = 0;
+  bool tracing = true;
+  bool animation = true;
+  bool perfStats = false;
+  std::string logComponents;
+  std::string logNodes;
+  double logStart = 0.0;
+  double logStop = 0.0;
+  bool ecmp = false;
+  uint32_t flows = 1;
+  bool linkStats = false;
+  bool frr = false;
+  double frrInterval = 1.0;
+  double frrDetection = 0.05;
+  std::string failure ("admin");
+  std::string failedLinks ("T");
+  bool bfd = false;
+  double bfdInterval = 0.05;
+  uint32_t bfdMultiplier = 3;
+  std::string pcapMode ("full");
+  uint32_t snapLen = 65535;
+  uint64_t pcapRotateBytes = 0;
+  double pcapRotateTime = 0.0;
+  uint32_t pcapRing = 1000;
+  double pcapPostTrigger = 1.0;
+  double pcapHoldoff = 5.0;
+  std::string pcapTriggers ("link-down,drop");
+  std::string medium ("p2p");
+  uint32_t segmentHosts = 0;
+  std::string segmentRate ("1Mbps");
+  bool mediumStats = false;
+  bool arpPopulate = false;
+  double arpAliveTimeout = 120.0;
+  double arpDeadTimeout = 100.0;
+  double arpWaitReply = 1.0;
+  uint32_t arpMaxRetries = 3;
+  uint32_t arpPendingQueue = 3;
+  bool arpStats = false;
+  std::string metrics;
+  std::string metricsFormat ("csv");
+  double metricsInterval = 1.0;
+  uint32_t metricsWindow = 10;
+  double metricsWriteInterval = 10.0;
+  bool slimRouters = false;
+  bool memoryStats = false;
+  std::string results;
+  bool routingChanges = false;
+  double pathTrace = 0.0;
+  bool loopMonitor = false;
+  double loopWindow = 1.0;
+  double appStart = 1.0;
+  double appStop = 110.0;
+  double failureAt = 40.0;
+  double stopTime = 131.0;
+  bool earlyStop = false;
+  double earlyStopHold = 5.0;
+  bool routerHosts = false;
+  std::string trafficMatrix;
 
   CommandLine cmd;
-  cmd.AddValue ("verbose", "turn on log components", verbose);
+  cmd.AddValue ("verbose", "write the binary event log topologia-2-ls-events.bin (see tools/event-log-decode.py)", verbose);
   cmd.AddValue ("printRoutingTables", "Print routing tables at 30, 60 and 90 seconds", printRoutingTables);
   cmd.AddValue ("showPings", "Show Ping6 reception", showPings);
+  cmd.AddValue ("queueStats", "Sample every device queue and write topologia-2-ls-queues.csv", queueStats);
+  cmd.AddValue ("queueStatsInterval", "Queue sampling interval in seconds", queueStatsInterval);
+  cmd.AddValue ("queueDisc", "Queue disc on router interfaces (PfifoFast, RED, CoDel, FqCoDel)", queueDisc);
+  cmd.AddValue ("flowStats", "Print per-flow delay, loss and throughput at the end", flowStats);
+  cmd.AddValue ("seed", "RNG seed shared by all replicas of a sweep", seed);
+  cmd.AddValue ("run", "RNG run number, one per replica", run);
+  cmd.AddValue ("startJitter", "Maximum random delay (s) added to the client start time", startJitter);
+  cmd.AddValue ("failureJitter", "Maximum random delay (s) added to the link failure time", failureJitter);
+  cmd.AddValue ("checkpointSave", "Save converged routes and ARP caches to this file", checkpointSave);
+  cmd.AddValue ("checkpointTime", "Time (s) at which checkpointSave is written", checkpointTime);
+  cmd.AddValue ("checkpointLoad", "Start from a saved checkpoint, shifting the timeline by its time", checkpointLoad);
+  cmd.AddValue ("fluidDemands", "Fluid background demands Src:Dst:Rate[,...] routed over the current paths", fluidDemands);
+  cmd.AddValue ("fluidInterval", "Interval (s) between fluid background path updates", fluidInterval);
+  cmd.AddValue ("scale", "Number of extra routers in a grid attached to router A (benchmark variants)", scale);
+  cmd.AddValue ("tracing", "Write ASCII and pcap traces", tracing);
+  cmd.AddValue ("animation", "Write the NetAnim XML file", animation);
+  cmd.AddValue ("perfStats", "Print the number of simulator events executed", perfStats);
+  cmd.AddValue ("logComponents", "Event log components (Ipv4,Rip,Olsr,Arp,Queue), empty for all", logComponents);
+  cmd.AddValue ("logNodes", "Event log node ids, comma separated, empty for all", logNodes);
+  cmd.AddValue ("logStart", "Event log window start (s)", logStart);
+  cmd.AddValue ("logStop", "Event log window stop (s), 0 for the end of the run", logStop);
+  cmd.AddValue ("ecmp", "Spread flows over equal-cost paths (per-flow hashing)", ecmp);
+  cmd.AddValue ("flows", "Number of parallel UDP echo flows from T to R", flows);
+  cmd.AddValue ("linkStats", "Print per-link utilisation at the end", linkStats);
+  cmd.AddValue ("frr", "Precompute loop-free alternates and switch to them when an interface goes down", frr);
+  cmd.AddValue ("frrInterval", "Interval (s) between loop-free alternate computations", frrInterval);
+  cmd.AddValue ("frrDetection", "Link failure detection time (s) before switching to the alternate", frrDetection);
+  cmd.AddValue ("failure", "How the link fails: admin (Ipv4::SetDown on both ends), silent (no traffic either way) or oneway", failure);
+  cmd.AddValue ("failedLinks", "Links taken down at failureAt: T (T-A and T-B) or core (B-D and A-C)", failedLinks);
+  cmd.AddValue ("bfd", "Run BFD sessions between neighbouring routers and take the interface down on detection", bfd);
+  cmd.AddValue ("bfdInterval", "BFD control packet interval (s)", bfdInterval);
+  cmd.AddValue ("bfdMultiplier", "BFD detection multiplier (missed packets before declaring the link down)", bfdMultiplier);
+  cmd.AddValue ("pcapMode", "Pcap capture: full (EnablePcapAll and ASCII trace, with tracing), stream or ring", pcapMode);
+  cmd.AddValue ("snapLen", "Bytes kept of each packet in stream and ring captures", snapLen);
+  cmd.AddValue ("pcapRotateBytes", "Start a new stream capture file after this many bytes, 0 to disable", pcapRotateBytes);
+  cmd.AddValue ("pcapRotateTime", "Start a new stream capture file after this many seconds, 0 to disable", pcapRotateTime);
+  cmd.AddValue ("pcapRing", "Packets kept in memory per interface in ring mode", pcapRing);
+  cmd.AddValue ("pcapPostTrigger", "Seconds captured after a trigger before the rings are written", pcapPostTrigger);
+  cmd.AddValue ("pcapHoldoff", "Seconds after a trigger starts a ring write during which triggers of the same kind are suppressed", pcapHoldoff);
+  cmd.AddValue ("pcapTriggers", "Events that write the rings: link-down, drop (comma separated)", pcapTriggers);
+  cmd.AddValue ("medium", "Link medium for the whole topology: csma (shared, half-duplex) or p2p (dedicated)", medium);
+  cmd.AddValue ("segmentHosts", "Extra UDP sources on router A: one shared CSMA segment, or one link each with p2p", segmentHosts);
+  cmd.AddValue ("segmentRate", "Sending rate of each extra source towards R", segmentRate);
+  cmd.AddValue ("mediumStats", "Print per-channel backoffs, drops and utilisation at the end", mediumStats);
+  cmd.AddValue ("arpPopulate", "Fill every ARP cache with permanent entries for its neighbours before the run", arpPopulate);
+  cmd.AddValue ("arpAliveTimeout", "ARP cache entry lifetime (s)", arpAliveTimeout);
+  cmd.AddValue ("arpDeadTimeout", "Time (s) an unresolved ARP entry is kept as dead", arpDeadTimeout);
+  cmd.AddValue ("arpWaitReply", "Time (s) waited for an ARP reply before retransmitting", arpWaitReply);
+  cmd.AddValue ("arpMaxRetries", "ARP request retransmissions before giving up", arpMaxRetries);
+  cmd.AddValue ("arpPendingQueue", "Packets queued per unresolved ARP entry", arpPendingQueue);
+  cmd.AddValue ("arpStats", "Print per-node ARP requests, replies, drops and resolution wait", arpStats);
+  cmd.AddValue ("metrics", "Write rolling-window metrics (RIP/OLSR messages, queues, delivered bytes, events) to this file", metrics);
+  cmd.AddValue ("metricsFormat", "Metrics file format: csv or line (InfluxDB line protocol)", metricsFormat);
+  cmd.AddValue ("metricsInterval", "Metrics sampling interval (s)", metricsInterval);
+  cmd.AddValue ("metricsWindow", "Samples in the rolling window each metric is aggregated over", metricsWindow);
+  cmd.AddValue ("metricsWriteInterval", "Interval (s) between metrics writes", metricsWriteInterval);
+  cmd.AddValue ("slimRouters", "Install only IPv4, ARP, ICMP, UDP and routing on the scale grid routers (no TCP, no IPv6, no mobility without animation)", slimRouters);
+  cmd.AddValue ("memoryStats", "Print the estimated memory per node and per component at the end", memoryStats);
+  cmd.AddValue ("results", "Append a JSON result record of this run to this file (see tools/results-query.py); per-run output files then take the record key as prefix", results);
+  cmd.AddValue ("routingChanges", "Print each route added, removed or modified when it changes, on every router", routingChanges);
+  cmd.AddValue ("pathTrace", "Fraction of the T/R application packets whose hops are traced to topologia-2-ls-paths.csv, 0 to disable", pathTrace);
+  cmd.AddValue ("loopMonitor", "Detect forwarding loops and no-route drops per destination prefix and failure event", loopMonitor);
+  cmd.AddValue ("loopWindow", "Aggregation window of the loop monitor in seconds", loopWindow);
+  cmd.AddValue ("appStart", "Start time (s) of the applications; the extra sources start 1 s later", appStart);
+  cmd.AddValue ("appStop", "Stop time (s) of the applications", appStop);
+  cmd.AddValue ("failureAt", "Time (s) of the link failure, before failureJitter", failureAt);
+  cmd.AddValue ("stopTime", "Time (s) at which the simulation stops", stopTime);
+  cmd.AddValue ("earlyStop", "Stop once routes and the T/R flow have been stable for earlyStopHold after the failure", earlyStop);
+  cmd.AddValue ("earlyStopHold", "Time (s) routes and flow must stay stable before an early stop", earlyStopHold);
+  cmd.AddValue ("routerHosts", "Attach one host to every router (HostRouterA, HostGridRouter0...) on its own link", routerHosts);
+  cmd.AddValue ("trafficMatrix", "UDP traffic between all hosts: uniform:<rate per pair>, gravity:<total rate> or file:<Src Dst Rate lines>", trafficMatrix);
   cmd.Parse (argc, argv);
+  ResultRecord record ("topologia-2-ls", argc, argv);
+
+  NS_ABORT_MSG_UNLESS (failure == "admin" || failure == "silent" || failure == "oneway",
+                       "Unknown failure mode " << failure);
+  NS_ABORT_MSG_UNLESS (failedLinks == "T" || failedLinks == "core", "Unknown failed links " << failedLinks);
+  NS_ABORT_MSG_UNLESS (pcapMode == "full" || pcapMode == "stream" || pcapMode == "ring",
+                       "Unknown pcap mode " << pcapMode);
+  NS_ABORT_MSG_UNLESS (metricsFormat == "csv" || metricsFormat == "line", "Unknown metrics format " << metricsFormat);
+  NS_ABORT_MSG_IF (loopMonitor && loopWindow <= 0, "loopWindow must be positive");
+  NS_ABORT_MSG_UNLESS (appStart < failureAt && failureAt < appStop && appStop <= stopTime,
+                       "The timeline needs appStart < failureAt < appStop <= stopTime");
+  NS_ABORT_MSG_IF (earlyStop && earlyStopHold <= 0, "earlyStopHold must be positive");
+
+  ConfigureArp (Seconds (arpAliveTimeout), Seconds (arpDeadTimeout), Seconds (arpWaitReply), arpMaxRetries,
+                arpPendingQueue);
+
+  RngSeedManager::SetSeed (seed);
+  RngSeedManager::SetRun (run);
+  record.SetSeed (seed, run);
+  // Com --results os arquivos da execucao levam a chave do registro
+  std::string outputPrefix = results.empty () ? std::string ("topologia-2-ls") : record.Key ();
+  std::cout << "Seed " << seed << " Run " << run << std::endl;
 
   if (verbose)
     {
-      LogComponentEnableAll (LogLevel (LOG_PREFIX_TIME | LOG_PREFIX_NODE));
-      LogComponentEnable ("Topologia2-ls", LOG_LEVEL_INFO);
-      LogComponentEnable ("Ipv4Interface", LOG_LEVEL_ALL);
-      LogComponentEnable ("Icmpv4L4Protocol", LOG_LEVEL_ALL);
-      LogComponentEnable ("Ipv4L3Protocol", LOG_LEVEL_ALL);
-      LogComponentEnable ("ArpCache", LOG_LEVEL_ALL);
-      LogComponentEnable ("V4Ping", LOG_LEVEL_ALL);
+      EventLog::Get ()->SetComponents (logComponents);
+      EventLog::Get ()->SetNodes (logNodes);
+      EventLog::Get ()->SetWindow (Seconds (logStart), Seconds (logStop));
+      EventLog::Get ()->Open (outputPrefix + "-events.bin");
     }
 	
   NS_LOG_INFO ("Create nodes.");
@@ -110,44 +305,39 @@ int main (int argc, char **argv)
 
   // We create the channels first without any IP addressing information
   NS_LOG_INFO ("Create channels.");
-  PointToPointHelper p2p;
+  MediumHelper links (medium);
   
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
-  NetDeviceContainer ndc1 = p2p.Install (net1);
+  links.SetLink (DataRate ("10Mbps"), Time ("2ms"));
+  NetDeviceContainer ndc1 = links.Install (net1);
   
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("10ms"));
-  NetDeviceContainer ndc2 = p2p.Install (net2);
+  links.SetLink (DataRate ("5Mbps"), Time ("10ms"));
+  NetDeviceContainer ndc2 = links.Install (net2);
   
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("50Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("50ms"));
-  NetDeviceContainer ndc3 = p2p.Install (net3);
+  links.SetLink (DataRate ("50Mbps"), Time ("50ms"));
+  NetDeviceContainer ndc3 = links.Install (net3);
   
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("5ms"));
-  NetDeviceContainer ndc4 = p2p.Install (net4);
+  links.SetLink (DataRate ("5Mbps"), Time ("5ms"));
+  NetDeviceContainer ndc4 = links.Install (net4);
 
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
-  NetDeviceContainer ndc5 = p2p.Install (net5);
+  links.SetLink (DataRate ("10Mbps"), Time ("2ms"));
+  NetDeviceContainer ndc5 = links.Install (net5);
  
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("10ms"));
-  NetDeviceContainer ndc6 = p2p.Install (net6);
+  links.SetLink (DataRate ("5Mbps"), Time ("10ms"));
+  NetDeviceContainer ndc6 = links.Install (net6);
 
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("50Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("50ms"));
-  NetDeviceContainer ndc7 = p2p.Install (net7);
+  links.SetLink (DataRate ("50Mbps"), Time ("50ms"));
+  NetDeviceContainer ndc7 = links.Install (net7);
 
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("10ms"));
-  NetDeviceContainer ndc8 = p2p.Install (net8);
+  links.SetLink (DataRate ("5Mbps"), Time ("10ms"));
+  NetDeviceContainer ndc8 = links.Install (net8);
 
-  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
-  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
-  NetDeviceContainer ndc9 = p2p.Install (net9);
+  links.SetLink (DataRate ("10Mbps"), Time ("2ms"));
+  NetDeviceContainer ndc9 = links.Install (net9);
   
+  NS_LOG_INFO ("Install queue discs on router interfaces.");
+  RouterQueueDiscs routerQueueDiscs;
+  routerQueueDiscs.Install (queueDisc, routers);
+
   NS_LOG_INFO ("Assign IPv4 Addresses.");
   Ipv4AddressHelper ipv4;
   
@@ -185,7 +375,83 @@ int main (int argc, char **argv)
   staticRouting2->SetDefaultRoute ("10.0.0.2", 1 );
   staticRouting2 = Ipv4RoutingHelper::GetRouting <Ipv4StaticRouting> (pcR->GetObject<Ipv4> ()->GetRoutingProtocol ());
   staticRouting2->SetDefaultRoute ("10.0.8.1", 1 );
+
+  if (ecmp)
+    {
+      EcmpRouting::Install (routers);
+    }
+
+  FastReroute fastReroute;
+  if (frr)
+    {
+      fastReroute.Install (routers, Seconds (frrInterval), Seconds (frrDetection));
+    }
+  Bfd bfdSessions;
+  if (bfd)
+    {
+      bfdSessions.Install (routers, Seconds (bfdInterval), bfdMultiplier);
+    }
+
+  // Variante escalada para o benchmark
+  MemoryAccounting memoryAccounting;
+  memoryAccounting.MarkStart ();
+  NodeContainer scaleRouters;
+  if (slimRouters)
+    {
+      SlimStackHelper slimStack;
+      slimStack.SetRoutingHelper (list);
+      scaleRouters = BuildRouterGrid (scale, a, links, slimStack, animation);
+    }
+  else
+    {
+      scaleRouters = BuildRouterGrid (scale, a, links, internet);
+    }
+  memoryAccounting.MarkEnd ("grid");
+
+  // Fontes extras dividindo um segmento (CSMA) ou com enlaces dedicados
+  NodeContainer hostSegment = AttachHostSegment (segmentHosts, a, links, internetNodes);
+
+  // Um host por roteador, pontas da matriz de trafego
+  NodeContainer attachedHosts;
+  if (routerHosts)
+    {
+      attachedHosts = AttachRouterHosts (NodeContainer (routers, scaleRouters), links, internetNodes);
+    }
+
+  double timeShift = 0.0;
+  RoutingCheckpoint checkpoint;
+  if (!checkpointLoad.empty ())
+    {
+      timeShift = checkpoint.Load (checkpointLoad);
+    }
+  if (!checkpointSave.empty ())
+    {
+      Simulator::Schedule (Seconds (checkpointTime), &SaveRoutingCheckpoint, routers, checkpointSave);
+    }
 	
+  // Streams fixos por componente: mesma (seed, run) reproduz a replica bit a bit
+  NS_LOG_INFO ("Assign random streams.");
+  int64_t stream = 0;
+  stream += internet.AssignStreams (routers, stream);
+  stream += internetNodes.AssignStreams (nodes, stream);
+  stream += olsr.AssignStreams (routers, stream);
+  Ptr<UniformRandomVariable> startJitterRv = CreateObject<UniformRandomVariable> ();
+  startJitterRv->SetAttribute ("Max", DoubleValue (startJitter));
+  startJitterRv->SetStream (stream++);
+  Ptr<UniformRandomVariable> failureJitterRv = CreateObject<UniformRandomVariable> ();
+  failureJitterRv->SetAttribute ("Max", DoubleValue (failureJitter));
+  failureJitterRv->SetStream (stream++);
+  stream += internet.AssignStreams (scaleRouters, stream);
+  stream += olsr.AssignStreams (scaleRouters, stream);
+  stream += internetNodes.AssignStreams (hostSegment, stream);
+  stream += internetNodes.AssignStreams (attachedHosts, stream);
+  TrafficMatrix matrix;
+  stream += matrix.AssignStreams (stream);
+  stream += bfdSessions.AssignStreams (stream);
+  // Modelos de erro do CutLink, dois por enlace derrubado
+  int64_t cutLinkStream = stream;
+  stream += 4;
+
   NS_LOG_INFO ("Create Applications.");
 //   uint32_t packetSize = 1024;
 //   Time interPacketInterval = Seconds (1.0);
@@ -207,8 +473,8 @@ int main (int argc, char **argv)
   uint16_t port = 9;  // well-known echo port number
   UdpEchoServerHelper server (port);
   ApplicationContainer apps = server.Install (pcR);
-  apps.Start (Seconds (1.0));
-  apps.Stop (Seconds (110.0));
+  apps.Start (Seconds (appStart));
+  apps.Stop (Seconds (appStop - timeShift));
 
 // Create a UdpEchoClient application to send UDP datagrams from node T to node R
   uint32_t packetSize = 1024;
@@ -218,7 +484,13 @@ int main (int argc, char **argv)
   client.SetAttribute ("MaxPackets", UintegerValue (maxPacketCount));
   client.SetAttribute ("Interval", TimeValue (interPacketInterval));
   client.SetAttribute ("PacketSize", UintegerValue (packetSize));
-  apps = client.Install (pcT);
+  ApplicationContainer clientApps = client.Install (pcT);
+  for (uint32_t i = 1; i < flows; i++)
+    {
+      clientApps.Add (client.Install (pcT));
+    }
+  clientApps.Start (Seconds (appStart + startJitterRv->GetValue ()));
+  clientApps.Stop (Seconds (appStop - timeShift));
 
   /* Gravando o ping de T*/
   V4PingHelper ping ("10.0.8.2");	
@@ -230,34 +502,132 @@ int main (int argc, char **argv)
     }
   apps = ping.Install (pcT);
 
-  apps.Start (Seconds (2.0));
-  apps.Stop (Seconds (110.0));
+  apps.Start (Seconds (appStart + 1.0 + startJitterRv->GetValue ()));
+  apps.Stop (Seconds (appStop - timeShift));
 
-  AsciiTraceHelper ascii;
-  p2p.EnableAsciiAll (ascii.CreateFileStream ("Topologia2.tr"));
-  p2p.EnablePcapAll ("Topologia2", true);
+  // Depois do T, para os hosts do segmento nao deslocarem o sorteio do jitter dele
+  ApplicationContainer segmentApps;
+  if (segmentHosts)
+    {
+      UdpClientHelper segmentClient (serverAddress, port);
+      segmentClient.SetAttribute ("MaxPackets", UintegerValue (0));
+      segmentClient.SetAttribute ("Interval", TimeValue (Seconds (1024 * 8.0 / DataRate (segmentRate).GetBitRate ())));
+      segmentClient.SetAttribute ("PacketSize", UintegerValue (1024));
+      segmentApps = segmentClient.Install (hostSegment);
+      segmentApps.Start (Seconds (appStart + 1.0 + startJitterRv->GetValue ()));
+      segmentApps.Stop (Seconds (appStop - timeShift));
+    }
+
+  if (!trafficMatrix.empty ())
+    {
+      matrix.SetSpec (trafficMatrix);
+      matrix.Install (NodeContainer (nodes, hostSegment, attachedHosts), 5000, Seconds (appStart + 1.0),
+                      Seconds (appStop - timeShift));
+    }
+
+  // Com --results os traces tambem levam a chave do run
+  std::string traceName = results.empty () ? std::string ("Topologia2") : outputPrefix;
+  // Nos modos stream e ring a captura e so a do PcapCapture, sem o trace ASCII
+  if (tracing && pcapMode == "full")
+    {
+      AsciiTraceHelper ascii;
+      links.EnableAsciiAll (ascii.CreateFileStream (traceName + ".tr"));
+      links.EnablePcapAll (traceName, true);
+    }
+  PcapCapture pcapCapture;
+  if (pcapMode != "full")
+    {
+      pcapCapture.SetSnapLen (snapLen);
+      pcapCapture.SetRotation (pcapRotateBytes, Seconds (pcapRotateTime));
+      if (pcapMode == "ring")
+        {
+          pcapCapture.SetRing (pcapRing, Seconds (pcapPostTrigger), Seconds (pcapHoldoff));
+          if (pcapTriggers.find ("drop") != std::string::npos)
+            {
+              pcapCapture.TriggerOnDrop (NodeContainer::GetGlobal ());
+            }
+        }
+      pcapCapture.Install (NodeContainer::GetGlobal (), traceName);
+    }
 	
   /* Derrubando a conexao entre os links T e A */
-  Simulator::Schedule (Seconds (40), &TearDownLink, b, d, 1, 0);	
-  Simulator::Schedule (Seconds (40), &TearDownLink, a, c, 1, 0);
+  Time failureTime = Seconds (failureAt - timeShift + failureJitterRv->GetValue ());
+  if (!checkpointLoad.empty ())
+    {
+      checkpoint.MarkFailure (failureTime);
+    }
+  if (failedLinks == "T")
+    {
+      Simulator::Schedule (failureTime, &TearDownLink, a, pcT, failure, cutLinkStream);
+      Simulator::Schedule (failureTime, &TearDownLink, b, pcT, failure, cutLinkStream + 2);
+    }
+  else
+    {
+      Simulator::Schedule (failureTime, &TearDownLink, b, d, failure, cutLinkStream);
+      Simulator::Schedule (failureTime, &TearDownLink, a, c, failure, cutLinkStream + 2);
+    }
+  if (pcapMode == "ring" && pcapTriggers.find ("link-down") != std::string::npos)
+    {
+      Simulator::Schedule (failureTime, &PcapCapture::Trigger, &pcapCapture, std::string ("link-down"));
+    }
+  OutageProbe outageProbe;
+  if (!results.empty ())
+    {
+      outageProbe.Install (pcR, port, failureTime);
+    }
+  RouteChangeLog routeChanges;
+  if (routingChanges || !results.empty ())
+    {
+      if (routingChanges)
+        {
+          routeChanges.Install (NodeContainer (routers, scaleRouters), std::cout);
+        }
+      else
+        {
+          // So para a secao "routing" do registro, sem imprimir
+          routeChanges.Install (NodeContainer (routers, scaleRouters), MilliSeconds (100));
+        }
+      // A queda nao gera mensagem no instante da falha
+      Simulator::Schedule (failureTime, &RouteChangeLog::CheckAll, &routeChanges);
+    }
+  PathTracer pathTracer;
+  if (pathTrace > 0)
+    {
+      pathTracer.Install (nodes, NodeContainer::GetGlobal (), pathTrace, outputPrefix + "-paths.csv");
+    }
+  ForwardingMonitor forwardingMonitor;
+  if (loopMonitor)
+    {
+      forwardingMonitor.Install (NodeContainer::GetGlobal (), Seconds (loopWindow));
+      forwardingMonitor.AddEvent (failureTime, "link-down");
+    }
+  ConvergenceStop convergenceStop;
+  if (earlyStop)
+    {
+      convergenceStop.Install (NodeContainer (routers, scaleRouters), pcR, port, failureTime, Seconds (earlyStopHold),
+                               Seconds (2 * interPacketInterval.GetSeconds ()), Seconds (stopTime - timeShift));
+    }
 
   /* Now, do the actual simulation. */
   NS_LOG_INFO ("Run Simulation.");
-  Simulator::Stop (Seconds (131.0));
+  Simulator::Stop (Seconds (stopTime - timeShift));
 
   MobilityHelper mobility;
   mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
   mobility.Install (nodes);
   mobility.Install (routers);
   
-  AnimationInterface anim ("animation_top2.xml");
-
-  anim.UpdateNodeDescription(pcT, "T");
-  anim.UpdateNodeDescription(pcR, "R");
-  anim.UpdateNodeDescription(a, "Router A");
-  anim.UpdateNodeDescription(b, "Router B");
-  anim.UpdateNodeDescription(c, "Router C");
-  anim.UpdateNodeDescription(d, "Router D");
+  AnimationInterface *anim = 0;
+  if (animation)
+    {
+      anim = new AnimationInterface ("animation_top2.xml");
+      anim->UpdateNodeDescription (pcT, "T");
+      anim->UpdateNodeDescription (pcR, "R");
+      anim->UpdateNodeDescription (a, "Router A");
+      anim->UpdateNodeDescription (b, "Router B");
+      anim->UpdateNodeDescription (c, "Router C");
+      anim->UpdateNodeDescription (d, "Router D");
+    }
 
   Ptr<ConstantPositionMobilityModel> s1 = pcT->GetObject<ConstantPositionMobilityModel> ();
   Ptr<ConstantPositionMobilityModel> s2 = pcR->GetObject<ConstantPositionMobilityModel> ();
@@ -274,7 +644,163 @@ int main (int argc, char **argv)
   s5->SetPosition (Vector ( 40.0,22.0,0.0  ));
   s6->SetPosition (Vector ( 40.0,66.5,0.0  ));
 	
+  FlowMonitorHelper flowHelper;
+  Ptr<FlowMonitor> flowMonitor;
+  if (flowStats || !results.empty ())
+    {
+      flowMonitor = flowHelper.InstallAll ();
+    }
+
+  FluidBackground fluidBackground;
+  if (!fluidDemands.empty ())
+    {
+      fluidBackground.SetDemands (fluidDemands);
+      fluidBackground.Start (Seconds (fluidInterval));
+    }
+
+  QueueMonitor queueMonitor;
+  if (queueStats)
+    {
+      queueMonitor.Install (NodeContainer::GetGlobal ());
+      queueMonitor.Start (Seconds (queueStatsInterval), outputPrefix + "-queues.csv");
+    }
+
+  LinkUtilisation linkUtilisation;
+  if (linkStats || !trafficMatrix.empty ())
+    {
+      linkUtilisation.Install (NodeContainer::GetGlobal ());
+    }
+
+  if (arpPopulate)
+    {
+      std::cout << "ARP entries pre-populated: " << PopulateArpCaches (NodeContainer::GetGlobal ()) << std::endl;
+    }
+  ArpStats arpCounters;
+  if (arpStats)
+    {
+      arpCounters.Install (NodeContainer::GetGlobal ());
+    }
+
+  NodeMetrics nodeMetrics;
+  if (!metrics.empty ())
+    {
+      nodeMetrics.Install (NodeContainer::GetGlobal ());
+      MetricsRegistry::Get ()->Start (metrics, metricsFormat == "line", Seconds (metricsInterval), metricsWindow,
+                                      static_cast<uint32_t> (metricsWriteInterval / metricsInterval + 0.5));
+    }
+
+  MediumStats mediumMonitor;
+  if (mediumStats)
+    {
+      mediumMonitor.Install (NodeContainer::GetGlobal ());
+    }
+
+  EventLog::Get ()->Install (NodeContainer::GetGlobal ());
+
   Simulator::Run ();
+  if (!results.empty ())
+    {
+      record.SetPerf ();
+      record.SetOutage (outageProbe);
+      if (!checkpointLoad.empty ())
+        {
+          record.SetSection ("checkpoint", checkpoint.ToJson ());
+        }
+      record.SetFlows (flowMonitor, DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ()));
+      if (loopMonitor)
+        {
+          record.SetSection ("forwarding", forwardingMonitor.ToJson ());
+        }
+      if (earlyStop)
+        {
+          record.SetSection ("timeline", convergenceStop.ToJson ());
+        }
+      if (!trafficMatrix.empty ())
+        {
+          record.SetSection ("matrix", matrix.ToJson ());
+        }
+      record.SetSection ("routing", routeChanges.ToJson (failureTime));
+      record.Append (results);
+    }
+  if (perfStats)
+    {
+      std::cout << "Events " << Simulator::GetEventCount () << std::endl;
+    }
+  if (queueStats)
+    {
+      queueMonitor.Print (std::cout);
+    }
+  if (!checkpointLoad.empty ())
+    {
+      checkpoint.Print (std::cout);
+    }
+  if (!fluidDemands.empty ())
+    {
+      fluidBackground.Print (std::cout);
+    }
+  if (linkStats || !trafficMatrix.empty ())
+    {
+      linkUtilisation.Print (std::cout);
+    }
+  if (frr)
+    {
+      fastReroute.Print (std::cout);
+    }
+  if (bfd)
+    {
+      bfdSessions.Print (std::cout, failureTime);
+    }
+  if (pcapMode != "full")
+    {
+      pcapCapture.Print (std::cout);
+    }
+  if (mediumStats)
+    {
+      mediumMonitor.Print (std::cout);
+    }
+  if (arpStats)
+    {
+      arpCounters.Print (std::cout);
+    }
+  if (memoryStats)
+    {
+      memoryAccounting.AddGroup ("routers", routers);
+      memoryAccounting.AddGroup ("grid", scaleRouters);
+      memoryAccounting.AddGroup ("hosts", nodes);
+      memoryAccounting.AddGroup ("segment", hostSegment);
+      memoryAccounting.AddGroup ("routerHosts", attachedHosts);
+      memoryAccounting.Print (std::cout);
+    }
+  if (routingChanges)
+    {
+      routeChanges.Print (std::cout);
+    }
+  if (pathTrace > 0)
+    {
+      pathTracer.Print (std::cout);
+    }
+  if (loopMonitor)
+    {
+      forwardingMonitor.Print (std::cout, "OLSR");
+    }
+  if (earlyStop)
+    {
+      convergenceStop.Print (std::cout);
+    }
+  if (!trafficMatrix.empty ())
+    {
+      matrix.Print (std::cout);
+      matrix.WriteCsv (outputPrefix + "-matrix.csv");
+    }
+  if (flowStats)
+    {
+      std::cout << "Queue disc: " << queueDisc << std::endl;
+      PrintFlowStats (flowMonitor, DynamicCast<Ipv4FlowClassifier> (flowHelper.GetClassifier ()), std::cout);
+      routerQueueDiscs.Print (std::cout);
+    }
   Simulator::Destroy ();
+  EventLog::Get ()->Close ();
+  MetricsRegistry::Get ()->Close ();
+  delete anim;
   NS_LOG_INFO ("Done.");
 }
@@ -0,0 +1,381 @@
+#ifndef TRAFFIC_MATRIX_H
+#define TRAFFIC_MATRIX_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/olsr-routing-protocol.h"
+#include "medium.h"
+
+namespace ns3 {
+
+/*
+ * Um host por roteador (Host<nome do roteador>), cada um num enlace proprio
+ * de 100 Mbps/1 ms em 10.64.0.0/10 (uma /24 por host) e com rota default
+ * estatica, para servir de origem e destino da matriz de trafego. Quando o
+ * roteador roda OLSR a sub-rede do host e anunciada como HNA, ja que o OLSR
+ * so calcula rotas para enderecos de interface dos nos OLSR.
+ *
+ * Como o AttachHostSegment, deve ser chamado depois do enderecamento
+ * original. Muda a taxa e o atraso correntes do MediumHelper.
+ */
+inline NodeContainer
+AttachRouterHosts (NodeContainer routers, MediumHelper &links, InternetStackHelper &stack)
+{
+  NodeContainer hosts;
+  hosts.Create (routers.GetN ());
+  for (uint32_t i = 0; i < routers.GetN (); i++)
+    {
+      Names::Add ("Host" + Names::FindName (routers.Get (i)), hosts.Get (i));
+    }
+  stack.Install (hosts);
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (hosts);
+
+  links.SetLink (DataRate ("100Mbps"), Time ("1ms"));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase (Ipv4Address ("10.64.0.0"), Ipv4Mask ("255.255.255.0"));
+  for (uint32_t i = 0; i < routers.GetN (); i++)
+    {
+      Ptr<Node> host = hosts.Get (i);
+      Ipv4InterfaceContainer iic = ipv4.Assign (links.Install (NodeContainer (routers.Get (i), host)));
+      ipv4.NewNetwork ();
+      host->GetObject<ConstantPositionMobilityModel> ()->SetPosition (Vector (10.0 + i * 5, 90.0, 0));
+      Ipv4RoutingHelper::GetRouting<Ipv4StaticRouting> (host->GetObject<Ipv4> ()->GetRoutingProtocol ())
+        ->SetDefaultRoute (iic.GetAddress (0), 1);
+      Ptr<olsr::RoutingProtocol> olsr = Ipv4RoutingHelper::GetRouting<olsr::RoutingProtocol> (
+        routers.Get (i)->GetObject<Ipv4> ()->GetRoutingProtocol ());
+      if (olsr)
+        {
+          olsr->AddHostNetworkAssociation (iic.GetAddress (0).CombineMask (Ipv4Mask ("255.255.255.0")),
+                                           Ipv4Mask ("255.255.255.0"));
+        }
+    }
+  return hosts;
+}
+
+/*
+ * Matriz de trafego UDP entre hosts: um UdpClient por par (origem, destino)
+ * com taxa constante e um UdpServer por destino, todos na mesma porta.
+ *
+ *   uniform:<taxa>   todos os pares ordenados de hosts, <taxa> cada
+ *   gravity:<taxa>   todos os pares, <taxa> total dividida pelo modelo
+ *                    gravitacional: par (i, j) proporcional a m_i * m_j, com
+ *                    massas exponenciais de media 1 sorteadas por host
+ *   file:<arquivo>   uma demanda "Origem Destino Taxa" por linha, nomes do
+ *                    Names; linhas vazias e comecando com # sao ignoradas
+ *                    e linhas repetidas para o mesmo par somam as taxas
+ *
+ * uniform e gravity crescem com n^2: acima de 100000 pares usar file.
+ *
+ * Cada cliente parte num instante sorteado dentro do primeiro intervalo de
+ * envio, para os pares nao andarem em fase. Os pares sao medidos pelos
+ * traces SendOutgoing da origem e LocalDeliver do destino (UDP para a porta
+ * da matriz). O resumo mostra, por par, taxa oferecida, pacotes e vazao
+ * entregue no periodo ativo; o CSV tem todos os pares.
+ */
+class TrafficMatrix
+{
+public:
+  TrafficMatrix ()
+    : m_port (5000), m_packetSize (1024)
+  {
+    m_mass = CreateObject<ExponentialRandomVariable> ();
+    m_offset = CreateObject<UniformRandomVariable> ();
+  }
+
+  void SetSpec (std::string spec)
+  {
+    std::string::size_type colon = spec.find (':');
+    NS_ABORT_MSG_IF (colon == std::string::npos, "Bad traffic matrix " << spec << " (expected mode:argument)");
+    m_mode = spec.substr (0, colon);
+    m_argument = spec.substr (colon + 1);
+    NS_ABORT_MSG_UNLESS (m_mode == "uniform" || m_mode == "gravity" || m_mode == "file",
+                         "Unknown traffic matrix mode " << m_mode);
+  }
+
+  void SetPacketSize (uint32_t bytes)
+  {
+    m_packetSize = bytes;
+  }
+
+  int64_t AssignStreams (int64_t stream)
+  {
+    m_mass->SetStream (stream);
+    m_offset->SetStream (stream + 1);
+    return 2;
+  }
+
+  void Install (NodeContainer hosts, uint16_t port, Time start, Time stop)
+  {
+    m_port = port;
+    m_start = start;
+    m_stop = stop;
+    if (m_mode == "file")
+      {
+        ReadFile (m_argument);
+      }
+    else
+      {
+        uint64_t n = hosts.GetN ();
+        NS_ABORT_MSG_IF (n * (n - 1) > 100000, "Traffic matrix with " << n * (n - 1) << " pairs, use file:");
+        std::vector<double> mass (n, 1.0);
+        double sum = 0;
+        for (uint32_t i = 0; m_mode == "gravity" && i < n; i++)
+          {
+            mass[i] = m_mass->GetValue ();
+          }
+        for (uint32_t i = 0; i < n; i++)
+          {
+            for (uint32_t j = 0; j < n; j++)
+              {
+                sum += i != j ? mass[i] * mass[j] : 0.0;
+              }
+          }
+        double rate = DataRate (m_argument).GetBitRate ();
+        for (uint32_t i = 0; i < n; i++)
+          {
+            for (uint32_t j = 0; j < n; j++)
+              {
+                if (i != j)
+                  {
+                    AddPair (hosts.Get (i), hosts.Get (j),
+                             m_mode == "uniform" ? rate : rate * mass[i] * mass[j] / sum);
+                  }
+              }
+          }
+      }
+
+    std::map<Ptr<Node>, bool> sources;
+    std::map<Ptr<Node>, bool> sinks;
+    for (std::vector<Pair>::const_iterator p = m_pairs.begin (); p != m_pairs.end (); ++p)
+      {
+        if (p->rate <= 0)
+          {
+            continue;
+          }
+        double interval = m_packetSize * 8.0 / p->rate;
+        UdpClientHelper client (p->dst->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal (), m_port);
+        uint32_t packets = static_cast<uint32_t> (std::ceil ((stop - start).GetSeconds () / interval)) + 1;
+        client.SetAttribute ("MaxPackets", UintegerValue (packets));
+        client.SetAttribute ("Interval", TimeValue (Seconds (interval)));
+        client.SetAttribute ("PacketSize", UintegerValue (m_packetSize));
+        ApplicationContainer apps = client.Install (p->src);
+        apps.Start (start + Seconds (m_offset->GetValue (0, interval)));
+        apps.Stop (stop);
+        if (!sources[p->src])
+          {
+            sources[p->src] = true;
+            p->src->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+              "SendOutgoing", MakeCallback (&TrafficMatrix::Send, this));
+          }
+        if (!sinks[p->dst])
+          {
+            sinks[p->dst] = true;
+            UdpServerHelper server (m_port);
+            apps = server.Install (p->dst);
+            apps.Start (start);
+            apps.Stop (stop);
+            p->dst->GetObject<Ipv4L3Protocol> ()->TraceConnectWithoutContext (
+              "LocalDeliver", MakeCallback (&TrafficMatrix::Deliver, this));
+          }
+      }
+  }
+
+  void Print (std::ostream &os) const
+  {
+    double active = Active ();
+    os << "Traffic matrix " << m_mode << ":" << m_argument << ", " << m_pairs.size () << " pairs over " << active
+       << "s" << std::endl;
+    for (std::vector<Pair>::const_iterator p = m_pairs.begin (); p != m_pairs.end () && m_pairs.size () <= 32; ++p)
+      {
+        os << "  " << Names::FindName (p->src) << "->" << Names::FindName (p->dst) << " ";
+        PrintValues (os, *p, active);
+      }
+    os << "  total ";
+    PrintValues (os, Total (), active);
+  }
+
+  /* Todos os pares, para quando o resumo omite a lista. */
+  void WriteCsv (std::string fileName) const
+  {
+    std::ofstream out (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (out.is_open (), "Cannot open traffic matrix file " << fileName);
+    double active = Active ();
+    out << "src,dst,offered_kbps,tx,rx,delivered_kbps,loss_pct" << std::endl;
+    for (std::vector<Pair>::const_iterator p = m_pairs.begin (); p != m_pairs.end (); ++p)
+      {
+        out << Names::FindName (p->src) << "," << Names::FindName (p->dst) << "," << p->rate / 1000 << ","
+            << p->txPackets << "," << p->rxPackets << "," << Delivered (*p, active) << "," << Loss (*p) << "\n";
+      }
+  }
+
+  /* Totais para o registro de resultado (result-record.h). */
+  std::string ToJson (void) const
+  {
+    double active = Active ();
+    Pair total = Total ();
+    std::ostringstream os;
+    os << "{\"pairs\": " << m_pairs.size () << ", \"offered_kbps\": " << total.rate / 1000
+       << ", \"delivered_kbps\": " << Delivered (total, active) << ", \"loss_pct\": " << Loss (total) << "}";
+    return os.str ();
+  }
+
+private:
+  struct Pair
+  {
+    Pair ()
+      : rate (0), txPackets (0), rxPackets (0), rxBytes (0)
+    {
+    }
+
+    Ptr<Node> src;
+    Ptr<Node> dst;
+    double rate;
+    uint64_t txPackets;
+    uint64_t rxPackets;
+    uint64_t rxBytes;
+  };
+
+  Pair Total (void) const
+  {
+    Pair total;
+    for (std::vector<Pair>::const_iterator p = m_pairs.begin (); p != m_pairs.end (); ++p)
+      {
+        total.rate += p->rate;
+        total.txPackets += p->txPackets;
+        total.rxPackets += p->rxPackets;
+        total.rxBytes += p->rxBytes;
+      }
+    return total;
+  }
+
+  /* Um par repetido soma a taxa ao que ja existe: um cliente por par. */
+  void AddPair (Ptr<Node> src, Ptr<Node> dst, double rate)
+  {
+    std::pair<uint32_t, uint32_t> key (src->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ().Get (),
+                                       dst->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal ().Get ());
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t>::const_iterator it = m_index.find (key);
+    if (it != m_index.end ())
+      {
+        m_pairs[it->second].rate += rate;
+        return;
+      }
+    Pair p;
+    p.src = src;
+    p.dst = dst;
+    p.rate = rate;
+    m_index[key] = m_pairs.size ();
+    m_pairs.push_back (p);
+  }
+
+  void ReadFile (std::string fileName)
+  {
+    std::ifstream in (fileName.c_str ());
+    NS_ABORT_MSG_UNLESS (in.is_open (), "Cannot open traffic matrix " << fileName);
+    std::string line;
+    while (std::getline (in, line))
+      {
+        std::istringstream fields (line);
+        std::string src;
+        std::string dst;
+        std::string rate;
+        if (!(fields >> src) || src[0] == '#')
+          {
+            continue;
+          }
+        NS_ABORT_MSG_UNLESS (fields >> dst >> rate, "Bad traffic matrix line " << line << " (expected Src Dst Rate)");
+        Ptr<Node> srcNode = Names::Find<Node> (src);
+        Ptr<Node> dstNode = Names::Find<Node> (dst);
+        NS_ABORT_MSG_IF (!srcNode || !dstNode, "Unknown node in traffic matrix line " << line);
+        // Os pares sao chaveados pelo endereco da interface 1: so hosts de uma interface
+        NS_ABORT_MSG_UNLESS (srcNode->GetObject<Ipv4> () && srcNode->GetObject<Ipv4> ()->GetNInterfaces () == 2
+                             && dstNode->GetObject<Ipv4> () && dstNode->GetObject<Ipv4> ()->GetNInterfaces () == 2,
+                             "Traffic matrix line " << line << " names a node that is not a single-interface host");
+        AddPair (srcNode, dstNode, DataRate (rate).GetBitRate ());
+      }
+  }
+
+  Pair *Find (const Ipv4Header &header)
+  {
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t>::const_iterator it =
+      m_index.find (std::make_pair (header.GetSource ().Get (), header.GetDestination ().Get ()));
+    return it == m_index.end () ? 0 : &m_pairs[it->second];
+  }
+
+  bool IsMatrix (const Ipv4Header &header, Ptr<const Packet> packet) const
+  {
+    UdpHeader udp;
+    return header.GetProtocol () == UdpL4Protocol::PROT_NUMBER && packet->PeekHeader (udp)
+           && udp.GetDestinationPort () == m_port;
+  }
+
+  void Send (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Pair *p = IsMatrix (header, packet) ? Find (header) : 0;
+    if (p)
+      {
+        p->txPackets++;
+      }
+  }
+
+  void Deliver (const Ipv4Header &header, Ptr<const Packet> packet, uint32_t interface)
+  {
+    Pair *p = IsMatrix (header, packet) ? Find (header) : 0;
+    if (p)
+      {
+        // Vazao de aplicacao, como a taxa oferecida: sem o cabecalho UDP
+        p->rxPackets++;
+        p->rxBytes += packet->GetSize () - UdpHeader ().GetSerializedSize ();
+      }
+  }
+
+  /* Periodo em que os clientes enviaram, menor se a simulacao parou antes. */
+  double Active (void) const
+  {
+    return (Min (Simulator::Now (), m_stop) - m_start).GetSeconds ();
+  }
+
+  static double Delivered (const Pair &p, double active)
+  {
+    return active > 0 ? p.rxBytes * 8.0 / active / 1000 : 0.0;
+  }
+
+  static double Loss (const Pair &p)
+  {
+    return p.txPackets ? 100.0 * (p.txPackets - std::min (p.rxPackets, p.txPackets)) / p.txPackets : 0.0;
+  }
+
+  void PrintValues (std::ostream &os, const Pair &p, double active) const
+  {
+    os << "offered=" << p.rate / 1000 << "kbps tx=" << p.txPackets << " rx=" << p.rxPackets
+       << " delivered=" << Delivered (p, active) << "kbps loss=" << Loss (p) << "%" << std::endl;
+  }
+
+  std::string m_mode;
+  std::string m_argument;
+  uint16_t m_port;
+  uint32_t m_packetSize;
+  Time m_start;
+  Time m_stop;
+  Ptr<ExponentialRandomVariable> m_mass;
+  Ptr<UniformRandomVariable> m_offset;
+  std::vector<Pair> m_pairs;
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> m_index;
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_H */